@@ -0,0 +1,586 @@
+#pragma once
+
+#include "Common.h"
+#include "Span.h"
+#include "SpinLock.h"
+#include "PageMap.h"
+#include "CentralCache.h"
+#include "ThreadCache.h"
+#include "ObjectPool.h"
+#include "MadviseBatch.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <iterator>
+#include <mutex>
+
+namespace KzAlloc {
+
+// =========================================================================
+// BasicAllocator<Policy> (按策略实例化的独立堆)
+// 全局的 KzAlloc::malloc 固定使用 PAGE_SHIFT / MAX_BYTES / SpinMutex。
+// 需要不同页大小、规格范围或锁类型的子系统 (例如 64KB 页的大缓冲区堆、4KB 页的小对象堆)
+// 可以各自实例化一个 BasicAllocator：每个策略一个单例，与全局堆及其他策略不共享任何状态
+// 结构是全局三层的精简版：
+// 1. 线程本地链表：复用 FreeList，批量上限与 ThreadCache 共用 InitListBatch (不做 Scavenge)
+// 2. 中心桶：每个规格一个 SpanListBucket<Policy::Lock>，规格表与 Span 页数由 SizeUtils::detail
+//    的同一套编译期函数按本堆的页大小生成，按占用率分级取 Span
+// 3. 页堆：一把 Policy::Lock，按页数分冷热链表，归还时与相邻空闲 Span 合并；
+//    空闲的驻留页超过 RELEASE_BYTES 时与 PageCache 一样从大到小 madvise 归还 (不分片、不做自适应阈值)
+// 超过 Policy::MAX_BYTES 的申请直接按页分配，128 页以上的直接向系统申请
+//
+// Policy 需要提供：
+//   static constexpr size_t PAGE_SHIFT; // 页偏移位数，12 ~ 16 (4KB ~ 64KB)
+//   static constexpr size_t MAX_BYTES;  // 走线程本地链表的上限，必须是某个规格的大小 (如 32KB、256KB、1MB)
+//   using Lock = ...;                   // 提供 lock / try_lock / unlock，如 SpinMutex、std::mutex
+// 可选：
+//   static constexpr size_t RELEASE_BYTES; // 页堆保留的空闲驻留字节上限，默认 DEFAULT_HEAP_RELEASE_BYTES
+// =========================================================================
+
+// 页堆默认保留的空闲驻留字节 (与 PageCache 单个分片的阈值下限同一量级)
+static constexpr size_t DEFAULT_HEAP_RELEASE_BYTES = 16 * 1024 * 1024;
+
+// 与全局堆参数相同的策略
+struct DefaultHeapPolicy {
+    static constexpr size_t PAGE_SHIFT = KzAlloc::PAGE_SHIFT;
+    static constexpr size_t MAX_BYTES = BASE_MAX_BYTES;
+    using Lock = SpinMutex;
+};
+
+// 独立堆的统计 (无锁读取)
+struct BasicHeapStats {
+    size_t systemBytes = 0;   // 向系统申请的总字节数
+    size_t releasedBytes = 0; // 累计 madvise 归还给 OS 的字节数
+    size_t lockContended = 0; // 中心桶与页堆加锁时发现锁已被占用的次数
+};
+
+template <class Policy>
+class BasicAllocator {
+public:
+    static constexpr size_t HEAP_PAGE_SHIFT = Policy::PAGE_SHIFT;
+    static constexpr size_t HEAP_PAGE_SIZE = (size_t)1 << HEAP_PAGE_SHIFT;
+    static constexpr size_t HEAP_MAX_BYTES = Policy::MAX_BYTES;
+    using Lock = typename Policy::Lock;
+
+    static_assert(HEAP_PAGE_SHIFT >= 12 && HEAP_PAGE_SHIFT <= 16, "Policy::PAGE_SHIFT must be in [12, 16]");
+    static_assert(HEAP_MAX_BYTES >= 8 && HEAP_MAX_BYTES <= 2 * 1024 * 1024, "Policy::MAX_BYTES must be in [8B, 2MB]");
+
+private:
+    // 编译期按全局的分段规则数桶，最后一个桶必须恰好是 MAX_BYTES
+    static constexpr size_t LastClassSize() {
+        size_t size = 0;
+        while (size < HEAP_MAX_BYTES) size = SizeUtils::detail::_CalculateNextBlockSize(size);
+        return size;
+    }
+    static constexpr int CountClasses() {
+        int n = 0;
+        for (size_t size = 0; size < HEAP_MAX_BYTES; ++n) size = SizeUtils::detail::_CalculateNextBlockSize(size);
+        return n;
+    }
+    static_assert(LastClassSize() == HEAP_MAX_BYTES, "Policy::MAX_BYTES must be a size class boundary");
+
+    static constexpr size_t ReleaseBytes() {
+        if constexpr (requires { Policy::RELEASE_BYTES; }) {
+            return Policy::RELEASE_BYTES;
+        } else {
+            return DEFAULT_HEAP_RELEASE_BYTES;
+        }
+    }
+
+public:
+    static constexpr int NCLASSES = CountClasses();
+    // 页堆空闲链表覆盖 1 ~ 128 页，更大的 Span 直接向系统申请
+    static constexpr size_t HEAP_NPAGES = 129;
+    // 页堆空闲驻留页超过这个数就归还给 OS
+    static constexpr size_t RELEASE_THRESHOLD_PAGES = ReleaseBytes() >> HEAP_PAGE_SHIFT;
+
+    static BasicAllocator* GetInstance() {
+        alignas(BasicAllocator) static char _buffer[sizeof(BasicAllocator)];
+        static BasicAllocator* _instance = nullptr;
+        static const bool _inited = [&]() {
+            _instance = new (_buffer) BasicAllocator();
+            return true;
+        }();
+        (void)_inited;
+        return _instance;
+    }
+
+    // ---------------------------------------------------------
+    // 申请与释放
+    // ---------------------------------------------------------
+    void* Allocate(size_t size) {
+        if (size > HEAP_MAX_BYTES) [[unlikely]] {
+            return AllocateLarge(size);
+        }
+        int index = Index(size);
+        FreeList& list = _tls.Get()->_lists[index];
+        if (!list.Empty()) [[likely]] {
+            return list.Pop();
+        }
+        return FetchFromCentral(list, index);
+    }
+
+    // Sized free：跳过 PageMap 查找
+    void Deallocate(void* ptr, size_t size) {
+        assert(ptr);
+        if (size > HEAP_MAX_BYTES) [[unlikely]] {
+            ReleaseSpan(_pageMap.get((PAGE_ID)ptr >> HEAP_PAGE_SHIFT));
+            return;
+        }
+        int index = Index(size);
+        FreeList& list = _tls.Get()->_lists[index];
+        list.Push(ptr);
+        if (list.Size() >= list.MaxSize() + list.TransferNum()) {
+            ReleaseToCentral(list, list.TransferNum(), index);
+        }
+    }
+
+    // 不带大小的释放：查本堆的 PageMap
+    void Deallocate(void* ptr) {
+        if (ptr == nullptr) return;
+        Span* span = _pageMap.get((PAGE_ID)ptr >> HEAP_PAGE_SHIFT);
+        assert(span && span->_isUse);
+        Deallocate(ptr, span->_objSize);
+    }
+
+    // 实际可用的大小
+    size_t RoundUp(size_t size) const {
+        if (size > HEAP_MAX_BYTES) return (size + HEAP_PAGE_SIZE - 1) & ~(HEAP_PAGE_SIZE - 1);
+        return _classToSize[Index(size)];
+    }
+
+    // 把当前线程的本地链表全部还给中心桶
+    void ReleaseThreadCache() {
+        LocalCache* cache = _tls.Peek();
+        if (cache) ReleaseLocal(cache);
+    }
+
+    BasicHeapStats GetStats() const {
+        BasicHeapStats stats;
+        stats.systemBytes = _systemBytes.load(std::memory_order_relaxed);
+        stats.releasedBytes = _releasedBytes.load(std::memory_order_relaxed);
+        stats.lockContended = _pageContended.load(std::memory_order_relaxed);
+        for (int i = 0; i < NCLASSES; ++i) {
+            stats.lockContended += _buckets[i]._contended.load(std::memory_order_relaxed);
+        }
+        return stats;
+    }
+
+private:
+    // ---------------------------------------------------------
+    // 线程本地链表
+    // ---------------------------------------------------------
+    struct LocalCache {
+        FreeList _lists[NCLASSES];
+    };
+
+    // 与 ThreadCacheManager 相同：TLS 中只放指针，链表从 ObjectPool 分配，线程退出时归还
+    class LocalCacheManager {
+    public:
+        ~LocalCacheManager() {
+            if (_cache) {
+                BasicAllocator* heap = GetInstance();
+                heap->ReleaseLocal(_cache);
+                heap->_localPool.Delete(_cache);
+                _cache = nullptr;
+            }
+        }
+
+        LocalCache* Get() {
+            if (_cache == nullptr) [[unlikely]] {
+                _cache = GetInstance()->NewLocal();
+            }
+            return _cache;
+        }
+
+        LocalCache* Peek() const { return _cache; }
+
+    private:
+        LocalCache* _cache = nullptr;
+    };
+
+    static inline thread_local LocalCacheManager _tls;
+
+    BasicAllocator() {
+        int index = 0;
+        for (size_t i = 0; i < std::size(_smallLookup); ++i) {
+            while (_classToSize[index] < (i << 3)) index++;
+            _smallLookup[i] = (uint16_t)index;
+        }
+        index = 0;
+        for (size_t i = 0; i < std::size(_largeLookup); ++i) {
+            while (_classToSize[index] < (i << 7)) index++;
+            _largeLookup[i] = (uint16_t)index;
+        }
+        index = 0;
+        for (size_t i = 0; i < std::size(_hugeLookup); ++i) {
+            size_t bound = std::min(i << HUGE_SHIFT, HEAP_MAX_BYTES);
+            while (_classToSize[index] < bound) index++;
+            _hugeLookup[i] = (uint16_t)index;
+        }
+    }
+
+    BasicAllocator(const BasicAllocator&) = delete;
+    BasicAllocator& operator=(const BasicAllocator&) = delete;
+
+    // 与 SizeUtils::Index 相同的三级查找表：
+    // [0, 1KB] 8B 粒度，(1KB, 256KB] 128B 粒度，(256KB, 2MB] 16KB 粒度
+    static constexpr size_t SMALL_MAX = std::min<size_t>(HEAP_MAX_BYTES, 1024);
+    static constexpr size_t LARGE_MAX = std::min<size_t>(HEAP_MAX_BYTES, BASE_MAX_BYTES);
+    static constexpr size_t HUGE_SHIFT = 14;
+
+    int Index(size_t size) const {
+        assert(size <= HEAP_MAX_BYTES);
+        if (size <= SMALL_MAX) [[likely]] {
+            return _smallLookup[(size + 7) >> 3];
+        }
+        if (size <= LARGE_MAX) {
+            return _largeLookup[(size + 127) >> 7];
+        }
+        return _hugeLookup[(size + ((size_t)1 << HUGE_SHIFT) - 1) >> HUGE_SHIFT];
+    }
+
+    LocalCache* NewLocal() {
+        LocalCache* cache = _localPool.New();
+        for (int i = 0; i < NCLASSES; ++i) {
+            InitListBatch(cache->_lists[i], _classToSize[i]);
+        }
+        return cache;
+    }
+
+    void ReleaseLocal(LocalCache* cache) {
+        for (int i = 0; i < NCLASSES; ++i) {
+            FreeList& list = cache->_lists[i];
+            if (list.Size() > 0) ReleaseToCentral(list, list.Size(), i);
+            list.SetMaxSize(1);
+        }
+    }
+
+    // 慢启动：每次 miss 批量翻倍，直到 MaxNum
+    void* FetchFromCentral(FreeList& list, int index) {
+        size_t batchNum = std::min(list.MaxSize() << 1, list.MaxNum());
+        list.SetMaxSize(batchNum);
+
+        void* start = nullptr;
+        void* end = nullptr;
+        size_t fetchNum = FetchRangeObj(start, end, batchNum, index);
+        assert(fetchNum >= 1);
+        if (fetchNum > 1) {
+            list.PushRange(NextObj(start), end, fetchNum - 1);
+        }
+        return start;
+    }
+
+    void ReleaseToCentral(FreeList& list, size_t n, int index) {
+        void* start = nullptr;
+        void* end = nullptr;
+        list.PopRange(start, end, n);
+        ReleaseListToSpans(start, index);
+    }
+
+    // ---------------------------------------------------------
+    // 中心桶
+    // ---------------------------------------------------------
+
+    // 从同一个 Span 取至多 n 个对象
+    size_t FetchRangeObj(void*& start, void*& end, size_t n, int index) {
+        SpanListBucket<Lock>& bucket = _buckets[index];
+        bucket.Lock();
+
+        Span* span = bucket.Fullest();
+        if (span == nullptr) {
+            // 桶锁 -> 页堆锁，顺序固定，不会死锁
+            span = NewSpan(_classToPages[index]);
+            Carve(span, _classToSize[index]);
+            bucket.Insert(span);
+            SpanListBucket<Lock>::AddStat(bucket._spanCount, 1);
+        }
+
+        start = span->_freeList;
+        end = start;
+        size_t actual = 1;
+        while (actual < n && NextObj(end) != nullptr) {
+            end = NextObj(end);
+            actual++;
+        }
+        span->_freeList = NextObj(end);
+        NextObj(end) = nullptr;
+        span->_useCount += actual;
+        bucket.Update(span);
+
+        bucket._mtx.unlock();
+        return actual;
+    }
+
+    void ReleaseListToSpans(void* start, int index) {
+        SpanListBucket<Lock>& bucket = _buckets[index];
+        SpanList emptied;
+
+        bucket.Lock();
+        while (start) {
+            void* next = NextObj(start);
+            Span* span = _pageMap.get((PAGE_ID)start >> HEAP_PAGE_SHIFT);
+            assert(span && span->_objSize == _classToSize[index]);
+            NextObj(start) = span->_freeList;
+            span->_freeList = start;
+            span->_useCount--;
+            if (span->_useCount == 0) {
+                bucket.Erase(span);
+                SpanListBucket<Lock>::SubStat(bucket._spanCount, 1);
+                emptied.PushFront(span);
+            } else {
+                bucket.Update(span);
+            }
+            start = next;
+        }
+        bucket._mtx.unlock();
+
+        // 空 Span 在桶锁外还给页堆
+        while (Span* span = emptied.PopFront()) {
+            ReleaseSpan(span);
+        }
+    }
+
+    // 把 Span 切成 size 大小的对象
+    void Carve(Span* span, size_t size) {
+        char* begin = (char*)(span->_pageId << HEAP_PAGE_SHIFT);
+        size_t count = (span->_n << HEAP_PAGE_SHIFT) / size;
+        assert(count >= 1);
+        char* cur = begin;
+        for (size_t i = 0; i + 1 < count; ++i) {
+            NextObj(cur) = cur + size;
+            cur += size;
+        }
+        NextObj(cur) = nullptr;
+        span->_freeList = begin;
+        span->_objSize = size;
+        span->_objCount = count;
+        span->_useCount = 0;
+        // 直接向系统申请的 Span 只映射了首页，切分对象后每一页都要能查到 Span
+        if (span->_n >= HEAP_NPAGES) {
+            for (size_t i = 1; i < span->_n; ++i) _pageMap.set(span->_pageId + i, span);
+        }
+    }
+
+    // ---------------------------------------------------------
+    // 页堆
+    // ---------------------------------------------------------
+    void* AllocateLarge(size_t size) {
+        size_t k = (size + HEAP_PAGE_SIZE - 1) >> HEAP_PAGE_SHIFT;
+        Span* span = NewSpan(k);
+        span->_objSize = k << HEAP_PAGE_SHIFT;
+        return (void*)(span->_pageId << HEAP_PAGE_SHIFT);
+    }
+
+    void LockPageHeap() {
+        if (!_pageMtx.try_lock()) [[unlikely]] {
+            _pageContended.store(_pageContended.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            _pageMtx.lock();
+        }
+    }
+
+    Span* NewSpan(size_t k) {
+        assert(k > 0);
+        if (k >= HEAP_NPAGES) {
+            Span* span = _spanPool.New();
+            span->_pageId = (PAGE_ID)AllocHeapPages(k) >> HEAP_PAGE_SHIFT;
+            span->_n = k;
+            span->_isUse = true;
+            _pageMap.set(span->_pageId, span);
+            return span;
+        }
+
+        LockPageHeap();
+        while (true) {
+            // 先用热 Span，没有再用冷 Span (已 madvise 的页在写入时重新缺页)
+            Span* span = PopFreeLocked(_freeSpans, k);
+            if (span == nullptr) span = PopFreeLocked(_coldSpans, k);
+            if (span) {
+                // 切下前 k 页，剩余部分保持原来的冷热状态挂回对应链表
+                if (span->_n > k) {
+                    Span* rest = _spanPool.New();
+                    rest->_pageId = span->_pageId + k;
+                    rest->_n = span->_n - k;
+                    rest->_isCold = span->_isCold;
+                    span->_n = k;
+                    InsertFreeLocked(rest);
+                }
+                span->_isUse = true;
+                span->_isCold = false;
+                for (size_t p = 0; p < k; ++p) _pageMap.set(span->_pageId + p, span);
+                _pageMtx.unlock();
+                return span;
+            }
+
+            // 没有足够大的空闲 Span：向系统申请 128 页
+            Span* big = _spanPool.New();
+            big->_pageId = (PAGE_ID)AllocHeapPages(HEAP_NPAGES - 1) >> HEAP_PAGE_SHIFT;
+            big->_n = HEAP_NPAGES - 1;
+            InsertFreeLocked(big);
+        }
+    }
+
+    // 从 lists 中取一个至少 k 页的空闲 Span (持有页堆锁)
+    Span* PopFreeLocked(SpanList* lists, size_t k) {
+        for (size_t i = k; i < HEAP_NPAGES; ++i) {
+            Span* span = lists[i].PopFront();
+            if (span == nullptr) continue;
+            if (!span->_isCold) _hotFreePages -= span->_n;
+            return span;
+        }
+        return nullptr;
+    }
+
+    // 按冷热挂入空闲链表，只映射首尾页 (持有页堆锁)
+    void InsertFreeLocked(Span* span) {
+        (span->_isCold ? _coldSpans : _freeSpans)[span->_n].PushFront(span);
+        if (!span->_isCold) _hotFreePages += span->_n;
+        _pageMap.set(span->_pageId, span);
+        _pageMap.set(span->_pageId + span->_n - 1, span);
+    }
+
+    void EraseFreeLocked(Span* span) {
+        (span->_isCold ? _coldSpans : _freeSpans)[span->_n].Erase(span);
+        if (!span->_isCold) _hotFreePages -= span->_n;
+    }
+
+    // 空闲驻留页超过阈值：与 PageCache 相同，从最大的热 Span 开始 madvise，直到回到阈值以内 (持有页堆锁)
+    void ReleaseToSystemLocked() {
+        MadviseBatch batch;
+        for (size_t i = HEAP_NPAGES - 1; i > 0 && _hotFreePages > RELEASE_THRESHOLD_PAGES; --i) {
+            while (_hotFreePages > RELEASE_THRESHOLD_PAGES) {
+                Span* span = _freeSpans[i].PopFront();
+                if (span == nullptr) break;
+                _hotFreePages -= span->_n;
+
+                // MadviseBatch 以全局页为单位：本堆的页比全局页小时，只归还完整落在 Span 内的全局页
+                uintptr_t begin = (uintptr_t)span->_pageId << HEAP_PAGE_SHIFT;
+                uintptr_t end = begin + (span->_n << HEAP_PAGE_SHIFT);
+                PAGE_ID first = (begin + PAGE_SIZE - 1) >> PAGE_SHIFT;
+                PAGE_ID last = end >> PAGE_SHIFT;
+                if (last > first) {
+                    batch.Add(first, last - first);
+                    _releasedBytes.fetch_add((last - first) << PAGE_SHIFT, std::memory_order_relaxed);
+                }
+                // 变冷后与冷邻居合并 (邻居的页已归还过，合并后仍整体为冷)
+                span->_isCold = true;
+                MergeNeighborsLocked(span);
+                InsertFreeLocked(span);
+            }
+        }
+        batch.Flush();
+    }
+
+    // 与左右同为空闲、冷热相同的邻居合并 (span 不在任何链表中，持有页堆锁)
+    // 冷热不同的不合并：否则合并后的 Span 只能整体记为热或冷，驻留页计数会多算或少算
+    void MergeNeighborsLocked(Span* span) {
+        while (true) {
+            Span* prev = _pageMap.get(span->_pageId - 1);
+            if (prev == nullptr || prev->_isUse || prev->_pageId + prev->_n != span->_pageId) break;
+            if (prev->_isCold != span->_isCold || prev->_n + span->_n >= HEAP_NPAGES) break;
+            EraseFreeLocked(prev);
+            span->_pageId = prev->_pageId;
+            span->_n += prev->_n;
+            _spanPool.Delete(prev);
+        }
+        while (true) {
+            Span* next = _pageMap.get(span->_pageId + span->_n);
+            if (next == nullptr || next->_isUse || next->_pageId != span->_pageId + span->_n) break;
+            if (next->_isCold != span->_isCold || next->_n + span->_n >= HEAP_NPAGES) break;
+            EraseFreeLocked(next);
+            span->_n += next->_n;
+            _spanPool.Delete(next);
+        }
+    }
+
+    void ReleaseSpan(Span* span) {
+        assert(span && span->_isUse);
+        span->_objSize = 0;
+        span->_objCount = 0;
+        span->_useCount = 0;
+        span->_freeList = nullptr;
+
+        if (span->_n >= HEAP_NPAGES) {
+            // 切分过对象的映射了每一页，大对象只映射了首页
+            size_t mapped = span->_n;
+            if (_pageMap.get(span->_pageId + 1) != span) mapped = 1;
+            for (size_t i = 0; i < mapped; ++i) _pageMap.set(span->_pageId + i, nullptr);
+            FreeHeapPages((void*)(span->_pageId << HEAP_PAGE_SHIFT), span->_n);
+            _spanPool.Delete(span);
+            return;
+        }
+
+        LockPageHeap();
+        span->_isUse = false;
+
+        // 刚还回的页是热的：只与热邻居合并，冷邻居等这段也变冷后再合并 (见 ReleaseToSystemLocked)
+        span->_isCold = false;
+        MergeNeighborsLocked(span);
+        InsertFreeLocked(span);
+        if (_hotFreePages > RELEASE_THRESHOLD_PAGES) {
+            ReleaseToSystemLocked();
+        }
+        _pageMtx.unlock();
+    }
+
+    // 向系统申请 k 个本堆的页，起点按本堆页大小对齐
+    void* AllocHeapPages(size_t k) {
+        size_t kpage = SystemPages(k);
+        void* ptr = nullptr;
+        if constexpr (HEAP_PAGE_SHIFT <= PAGE_SHIFT) {
+            ptr = SystemAlloc(kpage);
+        } else {
+#ifdef _WIN32
+            // VirtualAlloc 按 64KB 分配粒度对齐，已满足 PAGE_SHIFT <= 16
+            ptr = SystemAlloc(kpage);
+#else
+            // 多申请 (本堆页 - 全局页) 字节，对齐后切掉头尾
+            size_t slack = (HEAP_PAGE_SIZE >> PAGE_SHIFT) - 1;
+            char* raw = (char*)SystemAlloc(kpage + slack);
+            char* aligned = (char*)(((uintptr_t)raw + HEAP_PAGE_SIZE - 1) & ~(uintptr_t)(HEAP_PAGE_SIZE - 1));
+            size_t head = (size_t)(aligned - raw) >> PAGE_SHIFT;
+            if (head > 0) SystemFree(raw, head);
+            if (slack > head) SystemFree(aligned + (kpage << PAGE_SHIFT), slack - head);
+            ptr = aligned;
+#endif
+        }
+        _systemBytes.fetch_add(kpage << PAGE_SHIFT, std::memory_order_relaxed);
+        return ptr;
+    }
+
+    void FreeHeapPages(void* ptr, size_t k) {
+        size_t kpage = SystemPages(k);
+        SystemFree(ptr, kpage);
+        _systemBytes.fetch_sub(kpage << PAGE_SHIFT, std::memory_order_relaxed);
+    }
+
+    // k 个本堆的页折合的全局页数 (SystemAlloc 的单位)
+    static size_t SystemPages(size_t k) {
+        return ((k << HEAP_PAGE_SHIFT) + PAGE_SIZE - 1) >> PAGE_SHIFT;
+    }
+
+private:
+    // 规格表与 Span 页数：与全局的 _class_to_size / _class_to_pages 同一套编译期函数，按本堆的页大小计算
+    static constexpr std::array<size_t, NCLASSES> _classToSize = SizeUtils::detail::_BuildClassToSize<NCLASSES>();
+    static constexpr std::array<size_t, NCLASSES> _classToPages =
+        SizeUtils::detail::_BuildClassToPages<HEAP_PAGE_SHIFT>(_classToSize);
+    uint16_t _smallLookup[(SMALL_MAX >> 3) + 1] = {0};
+    uint16_t _largeLookup[(LARGE_MAX >> 7) + 1] = {0};
+    uint16_t _hugeLookup[HEAP_MAX_BYTES > BASE_MAX_BYTES ? (HEAP_MAX_BYTES >> HUGE_SHIFT) + 1 : 1] = {0};
+
+    SpanListBucket<Lock> _buckets[NCLASSES];
+
+    alignas(CACHE_LINE_SIZE) Lock _pageMtx;
+    SpanList _freeSpans[HEAP_NPAGES]; // 热：物理页还在
+    SpanList _coldSpans[HEAP_NPAGES]; // 冷：已 madvise 归还给 OS
+    size_t _hotFreePages = 0;
+    std::atomic<size_t> _pageContended{0};
+    std::atomic<size_t> _systemBytes{0};
+    std::atomic<size_t> _releasedBytes{0};
+
+    BasicPageMap<HEAP_PAGE_SHIFT> _pageMap;
+    ObjectPool<Span> _spanPool;
+    ObjectPool<LocalCache> _localPool;
+};
+
+} // namespace KzAlloc
@@ -3,85 +3,107 @@
 
 namespace KzAlloc {
 
-// 慢启动算法 (根据对齐后的大小计算应该一次性申请多少个aligned_size大小内存)
-static size_t CalculateFetchBatchSize(size_t aligned_size) {
-    size_t num = MAX_BYTES / aligned_size; 
-    if (num == 0) num = 1;
-    if (num > 512) num = 512;
-    return num;
-}
-
-// 计算申请页数
-// 此函数现在假设传入的已经是 aligned_size
-static size_t CalculatePageNeed(size_t aligned_size) {
-    size_t num = CalculateFetchBatchSize(aligned_size);
-    size_t npage = (num * aligned_size) >> PAGE_SHIFT; //
-    if (npage == 0) npage = 1;
-    return npage;
-}
-
-size_t CentralCache::FetchRangeObj(void*& start, void*& end, size_t n, size_t size) {
+size_t CentralCache::FetchRangeObj(void*& start, void*& end, size_t n, size_t size, bool longLived) {
     // 【优化1 - Hot Path】：直接使用 raw_size 查表
     // SizeUtils 保证了 Index(raw_size) == Index(aligned_size)
     // 避免了 RoundUp 的开销，因为如果桶里有货，我们根本不需要知道 aligned_size
     int index = SizeUtils::Index(size); //
-    auto& bucket = _spanLists[index];
+    return FetchFromBucket(Bucket(index, longLived), start, end, n, size, longLived, false);
+}
 
+size_t CentralCache::FetchIsolatedRange(void*& start, void*& end, size_t n, size_t size) {
+    return FetchFromBucket(_isolatedLists[SizeUtils::IsolatedIndex(size)], start, end, n, size, false, true);
+}
+
+size_t CentralCache::FetchFromBucket(SpanListBucket<SpinMutex>& bucket, void*& start, void*& end, size_t n,
+                                     size_t size, bool longLived, bool isolated) {
     // 加自旋锁
-    bucket._mtx.lock();
-
-    // 尝试获取 Span
-    // 注意：这里传入的是 raw_size，因为 GetOneSpan 只有在真要申请内存时才需要对齐
-    Span* span = GetOneSpan(bucket, size);
-    assert(span);
-    assert(span->_freeList);
-
-    // 从链表提取对象
-    // 这里的遍历不可避免，因为 span->_freeList 可能是乱序归还的，物理上不连续
-    start = span->_freeList;
-    end = start;
-    size_t actualNum = 1;
-    
-    while (actualNum < n && NextObj(end) != nullptr) {
-        void* next = NextObj(end);
-        __builtin_prefetch(NextObj(next), 0, 3);
-        end = next;
-        actualNum++;
-    }
+    bucket.Lock();
 
-    span->_freeList = NextObj(end);
-    NextObj(end) = nullptr; 
-    span->_useCount += actualNum;
+    // 从一个或多个 Span 中凑齐 n 个对象
+    // 单个 Span 的对象数有限 (例如 16B 的 Span 只有 512 个)，
+    // 如果只从一个 Span 取，大批量进货会被拆成很多次 FetchRangeObj 调用
+    start = nullptr;
+    end = nullptr;
+    size_t actualNum = 0;
 
+    while (actualNum < n) {
+        // 尝试获取 Span
+        // 注意：这里传入的是 raw_size，因为 GetOneSpan 只有在真要申请内存时才需要对齐
+        Span* span = GetOneSpan(bucket, size, longLived, isolated);
+        assert(span);
+        assert(span->_freeList);
+
+        // 从链表提取对象
+        // 这里的遍历不可避免，因为 span->_freeList 可能是乱序归还的，物理上不连续
+        void* spanStart = span->_freeList;
+        void* spanEnd = spanStart;
+        size_t got = 1;
+        
+        while (got < n - actualNum && NextObj(spanEnd) != nullptr) {
+            void* next = NextObj(spanEnd);
+            __builtin_prefetch(NextObj(next), 0, 3);
+            spanEnd = next;
+            got++;
+        }
+
+        span->_freeList = NextObj(spanEnd);
+        NextObj(spanEnd) = nullptr; 
+        span->_useCount += got;
+        bucket.Update(span); // 取空的 Span 会移入满级，不再参与挑选
+
+        // 拼接到输出链表尾部
+        if (end) {
+            NextObj(end) = spanStart;
+        } else {
+            start = spanStart;
+        }
+        end = spanEnd;
+        actualNum += got;
+    }
+
+    SpanListBucket<SpinMutex>::AddStat(bucket._inUseObjs, actualNum);
     bucket._mtx.unlock();
 
     return actualNum; 
 }
 
 // 入参是 raw_size
-Span* CentralCache::GetOneSpan(SpanListBucket<SpinMutex>& bucket, size_t size) {
-    // 1. 尝试从桶中查找现成的 Span
-    Span* it = bucket.Begin();
-    while (it != bucket.End()) {
-        if (it->_freeList != nullptr) {
-            return it;
-        }
-        it = static_cast<Span*>(it->_next);
+Span* CentralCache::GetOneSpan(SpanListBucket<SpinMutex>& bucket, size_t size, bool longLived, bool isolated) {
+    // 1. 尝试从桶中挑选最满的非满 Span (非满级中的 Span 必然有空闲对象)
+    if (Span* span = bucket.Fullest()) {
+        assert(span->_freeList);
+        return span;
     }
 
-    // 2. 桶空了，进入真正的 Cold Path -> 也就是这里才需要对齐
+    // 2. 有缓存的空 Span：它的对象已经全部串在 _freeList 上，直接复用，不用再切分
+    if (bucket._emptySpan) {
+        Span* span = bucket._emptySpan;
+        bucket._emptySpan = nullptr;
+        bucket.Insert(span);
+        _emptySpanHits.fetch_add(1, std::memory_order_relaxed);
+        return span;
+    }
+
+    // 3. 桶空了，进入真正的 Cold Path -> 也就是这里才需要对齐
     // 先解锁
     bucket._mtx.unlock();
 
     // 在此处进行对齐
     // 这是整个分配路径中唯一一次调用 RoundUp
-    size_t aligned_size = SizeUtils::RoundUp(size); 
-    size_t kPages = CalculatePageNeed(aligned_size);
+    // Span 页数在 SizeUtils::Init 时已按尾部浪费最小预计算好
+    // 隔离规格按粒度的整数倍切分，页数沿用能装下它的普通规格
+    size_t aligned_size = isolated ? SizeUtils::IsolatedClassSize(SizeUtils::IsolatedIndex(size))
+                                   : SizeUtils::RoundUp(size);
+    size_t kPages = SizeUtils::NumPages(SizeUtils::Index(aligned_size));
     
     PageHeap* ph = PageHeap::GetInstance();
     Span* span = ph->NewSpan(kPages); //
+    _spanCarves.fetch_add(1, std::memory_order_relaxed);
     span->_isUse = true;
     span->_objSize = aligned_size; // 记录对齐后的大小
+    span->_longLived = longLived;  // free 时据此把对象送回正确的池
+    span->_isolated = isolated;
 
     // 3. 切分内存 (Linking)
     // 使用 aligned_size 进行切分，保证无碎片
@@ -104,20 +126,27 @@ Span* CentralCache::GetOneSpan(SpanListBucket<SpinMutex>& bucket, size_t size) {
         cur += aligned_size;         
     }
     NextObj(tail) = nullptr;
+    span->_objCount = bytes / aligned_size;
+    span->_useCount = 0;
 
     // 重新加锁
-    bucket._mtx.lock();
-    bucket.PushFront(span);
+    bucket.Lock();
+    bucket.Insert(span);
+    SpanListBucket<SpinMutex>::AddStat(bucket._spanCount, 1);
+    SpanListBucket<SpinMutex>::AddStat(bucket._carvedObjs, span->_objCount);
 
     return span;
 }
 
-void CentralCache::ReleaseListToSpans(void* start, size_t size) {
+void CentralCache::ReleaseListToSpans(void* start, size_t size, bool longLived) {
     // 这里使用 raw_size 查表也是安全的
     int index = SizeUtils::Index(size);
-    auto& bucket = _spanLists[index];
+    auto& bucket = Bucket(index, longLived);
 
-    bucket._mtx.lock();
+    bucket.Lock();
+    size_t freed = 0;
+    void* strays = nullptr; // 属于另一个 Span 池的对象，解锁后再归还
+    void* isolatedStrays = nullptr; // 隔离对象被 sized free 按普通规格归还
 
     // int safety_ctr = 0;
     while (start) {
@@ -132,24 +161,24 @@ void CentralCache::ReleaseListToSpans(void* start, size_t size) {
         PAGE_ID id = (PAGE_ID)start >> PAGE_SHIFT;
         Span* span = PageMap::GetInstance()->get(id);
 
+        if (span->_longLived != longLived || span->_isolated) [[unlikely]] {
+            void*& list = span->_isolated ? isolatedStrays : strays;
+            NextObj(start) = list;
+            list = start;
+            start = next;
+            continue;
+        }
+
 #ifdef _DEBUG
         // 校验时最好 RoundUp 一下，或者只校验 Index 是否一致
         // assert(span->_objSize == SizeUtils::RoundUp(size));
 #endif
         
-        NextObj(start) = span->_freeList;
-        span->_freeList = start;
-        span->_useCount--;
-
-        if (span->_useCount == 0) {
-            bucket.Erase(span);
-            span->_freeList = nullptr; 
-            span->_next = nullptr;
-            span->_prev = nullptr;
-
+        freed++;
+        if (Span* victim = ReleaseObjLocked(bucket, span, start)) {
             bucket._mtx.unlock();
-            PageHeap::GetInstance()->ReleaseSpan(span);
-            bucket._mtx.lock();
+            PageHeap::GetInstance()->ReleaseSpan(victim);
+            bucket.Lock();
         }
         
         if (next) [[likely]] {
@@ -158,7 +187,195 @@ void CentralCache::ReleaseListToSpans(void* start, size_t size) {
             
         start = next;
     }
+
+    // 顺带检查缓存的空 Span 是否超时
+    Span* expired = bucket._emptySpan ? TakeExpiredEmptySpan(bucket, NowMilliseconds()) : nullptr;
+    SpanListBucket<SpinMutex>::SubStat(bucket._inUseObjs, freed);
     bucket._mtx.unlock();
+
+    if (expired) {
+        PageHeap::GetInstance()->ReleaseSpan(expired);
+    }
+    if (strays) [[unlikely]] {
+        ReleaseListToSpans(strays, size, !longLived);
+    }
+    if (isolatedStrays) [[unlikely]] {
+        ReleaseIsolatedList(isolatedStrays);
+    }
+}
+
+void CentralCache::ReleaseIsolatedList(void* start) {
+    SpanListBucket<SpinMutex>* bucket = nullptr;
+    size_t freed = 0;
+
+    while (start) {
+        void* next = NextObj(start);
+        Span* span = PageMap::GetInstance()->get((PAGE_ID)start >> PAGE_SHIFT);
+        assert(span->_isolated);
+
+        // 同一条链表通常只有一个规格，换规格时才换桶锁
+        auto* target = &_isolatedLists[SizeUtils::IsolatedIndex(span->_objSize)];
+        if (target != bucket) {
+            if (bucket) {
+                SpanListBucket<SpinMutex>::SubStat(bucket->_inUseObjs, freed);
+                bucket->_mtx.unlock();
+            }
+            bucket = target;
+            bucket->Lock();
+            freed = 0;
+        }
+
+        freed++;
+        if (Span* victim = ReleaseObjLocked(*bucket, span, start)) {
+            bucket->_mtx.unlock();
+            PageHeap::GetInstance()->ReleaseSpan(victim);
+            bucket->Lock();
+        }
+        start = next;
+    }
+
+    if (bucket) {
+        Span* expired = bucket->_emptySpan ? TakeExpiredEmptySpan(*bucket, NowMilliseconds()) : nullptr;
+        SpanListBucket<SpinMutex>::SubStat(bucket->_inUseObjs, freed);
+        bucket->_mtx.unlock();
+        if (expired) {
+            PageHeap::GetInstance()->ReleaseSpan(expired);
+        }
+    }
+}
+
+Span* CentralCache::ReleaseObjLocked(SpanListBucket<SpinMutex>& bucket, Span* span, void* obj) {
+    NextObj(obj) = span->_freeList;
+    span->_freeList = obj;
+    span->_useCount--;
+
+    if (span->_useCount != 0) [[likely]] {
+        // 占用率下降，可能需要换到更低的等级
+        bucket.Update(span);
+        return nullptr;
+    }
+    bucket.Erase(span);
+
+    // 先放进空 Span 缓存，下次 GetOneSpan 可以直接复用
+    return CacheEmptySpan(bucket, span);
+}
+
+Span* CentralCache::CacheEmptySpan(SpanListBucket<SpinMutex>& bucket, Span* span) {
+    // 缓存已关闭：直接还给 PageHeap
+    Span* victim = span;
+
+    if (_emptySpanTtlMs.load(std::memory_order_relaxed) != 0) {
+        // 每个桶只缓存一个，新变空的 Span 挤掉旧的 (新的更可能还在 CPU 缓存里)
+        victim = bucket._emptySpan;
+        bucket._emptySpan = span;
+        bucket._emptySince = NowMilliseconds();
+        if (victim) _emptySpanReleases.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if (victim) {
+        // 还给 PageHeap 前清空切分状态
+        victim->_freeList = nullptr;
+        SpanListBucket<SpinMutex>::SubStat(bucket._spanCount, 1);
+        SpanListBucket<SpinMutex>::SubStat(bucket._carvedObjs, victim->_objCount);
+    }
+    return victim;
+}
+
+Span* CentralCache::TakeExpiredEmptySpan(SpanListBucket<SpinMutex>& bucket, uint64_t now) {
+    Span* span = bucket._emptySpan;
+    if (span == nullptr || now - bucket._emptySince < _emptySpanTtlMs.load(std::memory_order_relaxed)) {
+        return nullptr;
+    }
+    bucket._emptySpan = nullptr;
+    span->_freeList = nullptr;
+    SpanListBucket<SpinMutex>::SubStat(bucket._spanCount, 1);
+    SpanListBucket<SpinMutex>::SubStat(bucket._carvedObjs, span->_objCount);
+    _emptySpanReleases.fetch_add(1, std::memory_order_relaxed);
+    return span;
+}
+
+void CentralCache::ReleaseEmptySpans(bool force) {
+    uint64_t now = force ? UINT64_MAX : NowMilliseconds();
+    for (size_t i = 0; i < 2 * MAX_NFREELISTS + ISOLATED_NCLASSES; ++i) {
+        auto& bucket = i < 2 * MAX_NFREELISTS ? Bucket(i % MAX_NFREELISTS, i >= MAX_NFREELISTS)
+                                              : _isolatedLists[i - 2 * MAX_NFREELISTS];
+        // 无锁预检，绝大多数桶没有缓存的空 Span
+        if (bucket._emptySpan == nullptr) continue;
+
+        bucket.Lock();
+        Span* span = TakeExpiredEmptySpan(bucket, now);
+        bucket._mtx.unlock();
+
+        if (span) {
+            PageHeap::GetInstance()->ReleaseSpan(span);
+        }
+    }
 }
 
+void CentralCache::SweepEmptySpans() {
+    uint64_t now = NowMilliseconds();
+    uint64_t last = _lastSweepMs.load(std::memory_order_relaxed);
+    if (now - last < EMPTY_SPAN_TTL_MS) return;
+    if (!_lastSweepMs.compare_exchange_strong(last, now, std::memory_order_relaxed)) return;
+    ReleaseEmptySpans(false);
+}
+
+#ifdef KZALLOC_USE_MAGAZINE
+Magazine* CentralCache::PopFullMagazine(size_t index) {
+    MagazineDepot& depot = _depots[index];
+    std::lock_guard<SpinMutex> lock(depot._mtx);
+
+    Magazine* mag = depot._full;
+    if (mag) {
+        depot._full = mag->_next;
+        depot._fullCount--;
+        mag->_next = nullptr;
+    }
+    return mag;
+}
+
+bool CentralCache::PushFullMagazine(size_t index, Magazine* mag) {
+    MagazineDepot& depot = _depots[index];
+    std::lock_guard<SpinMutex> lock(depot._mtx);
+
+    if (depot._fullCount >= MAX_DEPOT_MAGAZINES) {
+        return false;
+    }
+    mag->_next = depot._full;
+    depot._full = mag;
+    depot._fullCount++;
+    return true;
+}
+
+void CentralCache::ReleaseMagazineDepots() {
+    for (int i = 0; i < MAX_NFREELISTS; ++i) {
+        MagazineDepot& depot = _depots[i];
+        // 无锁预检，绝大多数 Depot 是空的
+        if (depot._full == nullptr) continue;
+
+        Magazine* mags = nullptr;
+        {
+            std::lock_guard<SpinMutex> lock(depot._mtx);
+            mags = depot._full;
+            depot._full = nullptr;
+            depot._fullCount = 0;
+        }
+
+        // 在 Depot 锁外归还，ReleaseListToSpans 要拿桶锁
+        while (mags) {
+            Magazine* next = mags->_next;
+            if (!mags->Empty()) {
+                void* end = nullptr;
+                void* start = mags->Link(end);
+                mags->_count = 0;
+                ReleaseListToSpans(start, SizeUtils::Size(i));
+            }
+            mags->_next = nullptr;
+            GetMagazinePool().Delete(mags);
+            mags = next;
+        }
+    }
+}
+#endif
+
 } // namespace KzAlloc
\ No newline at end of file
@@ -4,7 +4,9 @@
 #include "SpinLock.h"    // 
 #include "PageCache.h"  //
 #include "PageMap.h"    //
+#include "Magazine.h"
 #include <mutex>
+#include <atomic>
 
 namespace KzAlloc {
 
@@ -13,9 +15,100 @@ namespace KzAlloc {
 // 综合来说自旋锁性能会好些，因为大部分都是高速链表操作。
 // 但是在申请内存的时候可能会导致CPU大量空转，这时互斥锁会好些，不过，我们会在申请内存前手动释放自旋锁，所以也差不了
 // 并且，由于我们尽力降低了并发冲突，所以自旋锁就是最优解
+// 占用率分级数：非满 Span 按 _useCount / _objCount 落入 [0, OCCUPANCY_LEVELS) 级，
+// 满的 Span 单独放在第 OCCUPANCY_LEVELS 级
+static constexpr size_t OCCUPANCY_LEVELS = 8;
+
 template <class LockType>
-struct alignas(CACHE_LINE_SIZE) SpanListBucket : public SpanList {
+struct alignas(CACHE_LINE_SIZE) SpanListBucket {
     LockType _mtx;
+
+    // 按占用率分级的 Span 链表 (参考 tcmalloc 的 Span 优先级)
+    // 分配时优先从最满的非满 Span 取对象，稀疏的 Span 得以逐渐清空并还给 PageHeap，
+    // 而不是让对象均匀散落在大量半空的 Span 上
+    SpanList _levels[OCCUPANCY_LEVELS + 1];
+    uint32_t _nonEmpty = 0; // 第 i 位表示 _levels[i] 非空
+
+    // 空 Span 缓存：_useCount 归零的 Span 先在这里停留一段时间，
+    // 避免在 Span 边界上反复申请释放时，在 CentralCache 和 PageHeap 之间来回搬运 (Span Thrash)
+    Span* _emptySpan = nullptr;
+    uint64_t _emptySince = 0; // 进入缓存的时间 (毫秒)
+
+    // 统计：持锁者更新 (读改写不需要原子指令)，监控方不加锁直接读
+    std::atomic<size_t> _spanCount{0};  // 持有的 Span 数 (含空 Span 缓存)
+    std::atomic<size_t> _carvedObjs{0}; // 这些 Span 切出的对象总数
+    std::atomic<size_t> _inUseObjs{0};  // 已交给 ThreadCache (或用户) 的对象数
+    std::atomic<size_t> _contended{0};  // 加锁时发现锁已被占用的次数
+
+    // 先 try_lock，失败才记一次竞争再正常加锁 (无竞争时只多一次 try_lock)
+    void Lock() {
+        if (!_mtx.try_lock()) [[unlikely]] {
+            _contended.fetch_add(1, std::memory_order_relaxed);
+            _mtx.lock();
+        }
+    }
+
+    // 需持有 _mtx
+    static void AddStat(std::atomic<size_t>& counter, size_t delta) {
+        counter.store(counter.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+    }
+    static void SubStat(std::atomic<size_t>& counter, size_t delta) {
+        counter.store(counter.load(std::memory_order_relaxed) - delta, std::memory_order_relaxed);
+    }
+
+    static size_t LevelOf(const Span* span) {
+        assert(span->_objCount > 0);
+        return span->_useCount * OCCUPANCY_LEVELS / span->_objCount;
+    }
+
+    void Insert(Span* span) {
+        size_t level = LevelOf(span);
+        span->_occupancy = (uint8_t)level;
+        _levels[level].PushFront(span);
+        _nonEmpty |= 1u << level;
+    }
+
+    void Erase(Span* span) {
+        size_t level = span->_occupancy;
+        _levels[level].Erase(span);
+        if (_levels[level].Empty()) {
+            _nonEmpty &= ~(1u << level);
+        }
+    }
+
+    // _useCount 变化后调用，等级没变时什么都不做
+    void Update(Span* span) {
+        if (LevelOf(span) != span->_occupancy) {
+            Erase(span);
+            Insert(span);
+        }
+    }
+
+    // 返回最满的非满 Span，没有则返回 nullptr
+    Span* Fullest() {
+        uint32_t mask = _nonEmpty & ((1u << OCCUPANCY_LEVELS) - 1);
+        if (mask == 0) return nullptr;
+        size_t level = 31 - __builtin_clz(mask);
+        return _levels[level].Begin();
+    }
+};
+
+// 空 Span 在缓存中最多停留的时间 (默认值，可用 SetEmptySpanTtl 调整)
+static constexpr uint64_t EMPTY_SPAN_TTL_MS = 1000;
+
+// 空 Span 缓存统计
+struct EmptySpanStats {
+    size_t hits = 0;     // 直接复用缓存中的空 Span 的次数 (省下一次 NewSpan + 切分 + ReleaseSpan)
+    size_t releases = 0; // 缓存中的 Span 被挤出或超时而还给 PageHeap 的次数
+    size_t carves = 0;   // 向 PageHeap 申请新 Span 并切分的次数 (缓存没有命中时的代价)
+};
+
+// 单个 size class 的统计 (无锁读取)
+struct CentralClassStats {
+    size_t spans = 0;
+    size_t carvedObjs = 0;
+    size_t inUseObjs = 0;
+    size_t contended = 0;
 };
 
 // 单例模式：中心缓存
@@ -35,10 +128,61 @@ public:
     }
 
     // 从中心缓存获取一定数量的对象给 ThreadCache
-    size_t FetchRangeObj(void*& start, void*& end, size_t n, size_t size);
+    // longLived: 从长寿命 Span 池取 (见 _longLivedLists)
+    size_t FetchRangeObj(void*& start, void*& end, size_t n, size_t size, bool longLived = false);
 
     // 将 ThreadCache 归还的一串对象释放回对应的 Span
-    void ReleaseListToSpans(void* start, size_t size);
+    // 链表中不属于 longLived 所指 Span 池的对象 (例如长寿命对象被 sized free 归还) 会转交给另一个池
+    void ReleaseListToSpans(void* start, size_t size, bool longLived = false);
+
+    // 隔离 Span 池 (见 _isolatedLists)：size 不超过 ISOLATED_MAX_BYTES
+    size_t FetchIsolatedRange(void*& start, void*& end, size_t n, size_t size);
+
+    // 把一串隔离对象还给各自的 Span，每个对象按所在 Span 的规格找桶 (链表可以混有多个规格)
+    void ReleaseIsolatedList(void* start);
+
+    // 把各个桶中缓存的空 Span 还给 PageHeap
+    // force = false 时只归还超时的，true 时全部归还
+    void ReleaseEmptySpans(bool force);
+
+    // 周期性清扫：距上一次清扫超过 EMPTY_SPAN_TTL_MS 才执行 ReleaseEmptySpans(false)
+    // 超时检查原本只发生在同一个桶的下一次归还上，不再使用的规格会一直钉着它的空 Span；
+    // 由 ThreadCache::Scavenge 与压力监控线程调用，多个线程同时到达时只有一个执行
+    void SweepEmptySpans();
+
+    EmptySpanStats GetEmptySpanStats() const {
+        EmptySpanStats stats;
+        stats.hits = _emptySpanHits.load(std::memory_order_relaxed);
+        stats.releases = _emptySpanReleases.load(std::memory_order_relaxed);
+        stats.carves = _spanCarves.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+    // 空 Span 的缓存时间；0 表示关闭缓存，变空的 Span 立即还给 PageHeap (对比测试用)
+    void SetEmptySpanTtl(uint64_t ms) { _emptySpanTtlMs.store(ms, std::memory_order_relaxed); }
+
+    // 读取某个 size class 的统计，不加桶锁
+    CentralClassStats GetClassStats(size_t index, bool longLived = false) const {
+        const auto& bucket = longLived ? _longLivedLists[index] : _spanLists[index];
+        CentralClassStats stats;
+        stats.spans = bucket._spanCount.load(std::memory_order_relaxed);
+        stats.carvedObjs = bucket._carvedObjs.load(std::memory_order_relaxed);
+        stats.inUseObjs = bucket._inUseObjs.load(std::memory_order_relaxed);
+        stats.contended = bucket._contended.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+#ifdef KZALLOC_USE_MAGAZINE
+    // 从 Depot 取一只满弹匣，没有则返回 nullptr
+    Magazine* PopFullMagazine(size_t index);
+
+    // 把一只满弹匣放进 Depot，Depot 已满返回 false (调用者自行把对象还给 Span)
+    bool PushFullMagazine(size_t index, Magazine* mag);
+
+    // 把所有 Depot 中的满弹匣倒空，对象还给 Span，弹匣还给弹匣池
+    // 线程缓存冲刷与内存压力时调用
+    void ReleaseMagazineDepots();
+#endif
 
     
 
@@ -47,14 +191,55 @@ private:
     CentralCache(const CentralCache&) = delete;
     CentralCache& operator=(const CentralCache&) = delete;
 
+    SpanListBucket<SpinMutex>& Bucket(size_t index, bool longLived) {
+        return longLived ? _longLivedLists[index] : _spanLists[index];
+    }
+
+    // 从 bucket 中凑齐 n 个对象 (FetchRangeObj 与 FetchIsolatedRange 共用)
+    size_t FetchFromBucket(SpanListBucket<SpinMutex>& bucket, void*& start, void*& end, size_t n,
+                           size_t size, bool longLived, bool isolated);
+
     // 获取一个非空的 Span
     // 为了解耦，这里传入具体的 Bucket 类型
-    Span* GetOneSpan(SpanListBucket<SpinMutex>& bucket, size_t size);
+    // isolated: 按隔离规格 (而不是普通规格) 切分新 Span
+    Span* GetOneSpan(SpanListBucket<SpinMutex>& bucket, size_t size, bool longLived, bool isolated);
+
+    // 把一个对象还给它所在的 Span (需持有桶锁)
+    // 返回需要还给 PageHeap 的 Span (Span 变空后被挤出空 Span 缓存)，没有则返回 nullptr
+    Span* ReleaseObjLocked(SpanListBucket<SpinMutex>& bucket, Span* span, void* obj);
+
+    // 把一个刚变空的 Span 放进桶的空 Span 缓存 (需持有桶锁)
+    // 返回需要还给 PageHeap 的 Span (被挤出或已超时的)，没有则返回 nullptr
+    Span* CacheEmptySpan(SpanListBucket<SpinMutex>& bucket, Span* span);
+
+    // 如果桶里缓存的空 Span 已超时，取出并返回它 (需持有桶锁)
+    Span* TakeExpiredEmptySpan(SpanListBucket<SpinMutex>& bucket, uint64_t now);
 
 private:
     // 这里显式指定使用 SpinMutex
     // 如果未来想对比性能，改成 SpanListBucket<std::mutex> 即可
     SpanListBucket<SpinMutex> _spanLists[MAX_NFREELISTS]; 
+
+    // 长寿命对象 (malloc_hint(size, KZ_LONG_LIVED)) 单独使用的 Span 池
+    // 同一 size class 的短命对象和长寿命对象如果共用 Span，一个长寿命对象就能钉住
+    // 一整个 Span 的页，而它的邻居早已释放；分开之后短命对象的 Span 能整体变空还给 PageHeap
+    SpanListBucket<SpinMutex> _longLivedLists[MAX_NFREELISTS];
+
+    // malloc_isolated 的专用规格 (隔离粒度的整数倍) 单独使用的 Span 池
+    // Span 按规格步长从页边界开始切分，每个对象独占整数个粒度块；
+    // 普通规格的对象不会落进这些 Span，隔离对象的邻居只可能是另一个隔离对象
+    SpanListBucket<SpinMutex> _isolatedLists[ISOLATED_NCLASSES];
+
+    std::atomic<size_t> _emptySpanHits{0};
+    std::atomic<size_t> _emptySpanReleases{0};
+    std::atomic<size_t> _spanCarves{0};
+    std::atomic<uint64_t> _emptySpanTtlMs{EMPTY_SPAN_TTL_MS};
+    std::atomic<uint64_t> _lastSweepMs{0};
+
+#ifdef KZALLOC_USE_MAGAZINE
+    // 满弹匣仓库，ThreadCache 之间以整只弹匣为单位流转
+    MagazineDepot _depots[MAX_NFREELISTS];
+#endif
 };
 
 } // namespace KzAlloc
\ No newline at end of file
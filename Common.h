@@ -5,22 +5,38 @@
 #include <cassert>
 #include <new> // for std::bad_alloc
 #include <mutex>
+#include <chrono>
+#include <array>
 
 
 // 平台宏判断
 #ifdef _WIN32
     #include <windows.h>
+    #include <intrin.h> // __rdtsc
 #else
     #include <sys/mman.h>
     #include <unistd.h>
     #include <sys/sysinfo.h> // Linux sysinfo
     #include <sys/syscall.h>
+    #include <fcntl.h>
+    #include <cstring>
+    #include <cstdlib>
     
 #endif
 #include <assert.h>
 
 #define CACHE_LINE_SIZE 64 // 缓存行对齐
 
+// malloc_isolated 的隔离粒度：默认两个缓存行
+// Intel 的相邻行预取器 (spatial prefetcher) 按 128B 对成对取行，只隔开 64B 仍可能互相干扰
+// 可以用 -DKZALLOC_ISOLATION_BYTES=64 改成单个缓存行 (必须是 8 ~ 1024 之间的 2 的幂)
+#ifndef KZALLOC_ISOLATION_BYTES
+#define KZALLOC_ISOLATION_BYTES 128
+#endif
+static_assert(KZALLOC_ISOLATION_BYTES >= 8 && KZALLOC_ISOLATION_BYTES <= 1024 &&
+              (KZALLOC_ISOLATION_BYTES & (KZALLOC_ISOLATION_BYTES - 1)) == 0,
+              "KZALLOC_ISOLATION_BYTES must be a power of two in [8, 1024]");
+
 namespace KzAlloc {
 
 // 辅助函数
@@ -69,6 +85,116 @@ inline size_t GetSystemPhysicalMemory() {
     return 8ULL * 1024 * 1024 * 1024; 
 }
 
+#ifndef _WIN32
+namespace detail {
+// 读取只含一个数值的 cgroup 文件 (memory.max 等)
+// 文件不存在、内容为 "max" (不限制) 或无法解析时返回 0
+inline size_t ReadCgroupValue(const char* path) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return 0;
+    char buf[64];
+    ssize_t len = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if (len <= 0) return 0;
+    buf[len] = '\0';
+    if (buf[0] < '0' || buf[0] > '9') return 0;
+    return static_cast<size_t>(std::strtoull(buf, nullptr, 10));
+}
+} // namespace detail
+#endif
+
+// 获取本进程所在 cgroup v2 的内存上限 (字节)，返回 0 表示没有限制
+// 1. 从 /proc/self/cgroup 的 "0::<path>" 一行得到所在的 cgroup
+// 2. 从该 cgroup 一直向上走到根，取所有 memory.max / memory.high 中最小的 (祖先的限制同样生效)
+// root 为 cgroup2 的挂载点 (测试时可以指向伪造的目录树)，
+// 为空时取环境变量 KZALLOC_CGROUP_ROOT，再缺省为 /sys/fs/cgroup
+// 只用 open/read 和栈上缓冲区，不分配内存 (PageHeap 构造时调用)
+inline size_t GetCgroupMemoryLimit(const char* root = nullptr) {
+#ifdef _WIN32
+    (void)root;
+    return 0;
+#else
+    if (root == nullptr) {
+        root = std::getenv("KZALLOC_CGROUP_ROOT");
+        if (root == nullptr || *root == '\0') root = "/sys/fs/cgroup";
+    }
+
+    char buf[4096];
+    int fd = open("/proc/self/cgroup", O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return 0;
+    ssize_t len = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if (len <= 0) return 0;
+    buf[len] = '\0';
+
+    const char* rel = nullptr;
+    if (std::strncmp(buf, "0::", 3) == 0) {
+        rel = buf + 3;
+    } else if (const char* line = std::strstr(buf, "\n0::")) {
+        rel = line + 4;
+    }
+    if (rel == nullptr) return 0; // 纯 cgroup v1 主机
+
+    char path[4096 + 64];
+    size_t rootLen = std::strlen(root);
+    size_t relLen = std::strcspn(rel, "\n");
+    if (rootLen + relLen + 32 > sizeof(path)) return 0;
+    std::memcpy(path, root, rootLen);
+    std::memcpy(path + rootLen, rel, relLen);
+    size_t dirLen = rootLen + relLen;
+    while (dirLen > rootLen && path[dirLen - 1] == '/') --dirLen;
+
+    static const char* const files[] = {"/memory.max", "/memory.high"};
+    size_t limit = 0;
+    for (;;) {
+        for (const char* file : files) {
+            std::memcpy(path + dirLen, file, std::strlen(file) + 1);
+            size_t val = detail::ReadCgroupValue(path);
+            if (val > 0 && (limit == 0 || val < limit)) limit = val;
+        }
+        if (dirLen <= rootLen) break;
+        // 上移一层
+        while (dirLen > rootLen && path[dirLen - 1] != '/') --dirLen;
+        if (dirLen > rootLen) --dirLen;
+    }
+    return limit;
+#endif
+}
+
+// 进程实际能用的内存 (字节)：物理内存与 cgroup 限制取小
+// 第一次调用时算好并缓存 (运行中调整容器限制的情况不跟踪)
+inline size_t GetEffectiveMemoryLimit() {
+    static const size_t limit = []() {
+        size_t phys = GetSystemPhysicalMemory();
+        size_t cg = GetCgroupMemoryLimit();
+        return (cg > 0 && cg < phys) ? cg : phys;
+    }();
+    return limit;
+}
+
+// 单调时钟 (毫秒)，只在慢速路径上使用 (窗口统计、定时回收等)
+inline uint64_t NowMilliseconds() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// 周期计数器，只用于统计短临界区的耗时 (持锁时间等)
+// 没有计数器指令的平台退回单调时钟的纳秒数
+inline uint64_t CycleCount() {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    return __rdtsc();
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    return __builtin_ia32_rdtsc();
+#elif (defined(__GNUC__) || defined(__clang__)) && defined(__aarch64__)
+    uint64_t val;
+    __asm__ volatile("mrs %0, cntvct_el0" : "=r"(val));
+    return val;
+#else
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
 // 2MB 阈值，超过这个值尝试申请大页 (Linux 默认大页通常是 2MB)
 static constexpr size_t HUGE_PAGE_THRESHOLD = 2 * 1024 * 1024;
 // 向系统申请 kpage 页的内存
@@ -180,14 +306,50 @@ inline void SystemFree(void* ptr, size_t kpage) {
 // [1KB, 8KB]: 128B 对齐
 // [8KB, 64KB]: 512B 对齐
 // [64KB, 256KB]: 8KB 对齐
-static constexpr int MAX_NFREELISTS = 264;
-static constexpr size_t MAX_BYTES = 256 * 1024;
+static constexpr int BASE_NFREELISTS = 264;
+static constexpr size_t BASE_MAX_BYTES = 256 * 1024;
+
+// 可选的扩展规格 (CMake 选项 KZALLOC_EXTENDED_CLASSES)：
+// 网络缓冲区、列存数据块等 256KB ~ 2MB 的对象也走 ThreadCache，而不是每次都去抢 PageHeap 的分片锁
+// [256KB, 1MB]: 16KB 对齐 (48 个桶)
+// [1MB, 2MB]: 64KB 对齐 (16 个桶)
+#ifdef KZALLOC_EXTENDED_CLASSES
+static constexpr int MAX_NFREELISTS = BASE_NFREELISTS + 48 + 16;
+static constexpr size_t MAX_BYTES = 2 * 1024 * 1024;
+#else
+static constexpr int MAX_NFREELISTS = BASE_NFREELISTS;
+static constexpr size_t MAX_BYTES = BASE_MAX_BYTES;
+#endif
+
+// malloc_isolated 的专用规格：隔离粒度的 1 ~ ISOLATED_NCLASSES 倍，在单独的 Span 池中按规格步长切分
+// 更大的隔离申请取整到粒度的整数倍后走普通规格 (见 SizeUtils::IsolatedSize)
+static constexpr size_t ISOLATED_NCLASSES = 32;
+static constexpr size_t ISOLATED_MAX_BYTES = ISOLATED_NCLASSES * KZALLOC_ISOLATION_BYTES;
+static_assert(ISOLATED_MAX_BYTES <= MAX_BYTES, "isolated classes must be small objects");
+
+// 批量规则的字节基准 (NumMoveSize 与 Span 页数的经验公式)
+// 与 MAX_BYTES 分开：打开扩展规格不会放大小对象的批发量
+static constexpr size_t BATCH_BYTES = 256 * 1024;
 // =========================================================================
 // SizeUtils
 // 管理内存对齐和桶映射的静态工具集
 // =========================================================================
-inline uint16_t _size_lookup_table[MAX_BYTES + 1] = {0};
-inline size_t _class_to_size[MAX_NFREELISTS] = {0};
+// 两级查找表 (参考 tcmalloc 的 ClassIndex)：
+// [0, 1024B]   按 8B 粒度索引   -> (size + 7) >> 3
+// (1KB, 256KB] 按 128B 粒度索引 -> (size + 127) >> 7
+// 1KB 以上的桶边界全部是 128 的倍数，所以同一个 128B 粒度格子必然落在同一个桶里。
+// 两张表合计约 4KB，取代原来 512KB 的逐字节大表，Init 时几乎不产生缺页
+// 扩展规格再加一张 (256KB, 2MB] 按 16KB 粒度索引的表 (桶边界都是 16KB 的倍数)
+static constexpr size_t SMALL_LOOKUP_MAX = 1024;
+inline uint16_t _small_lookup_table[(SMALL_LOOKUP_MAX >> 3) + 1] = {0};
+inline uint16_t _large_lookup_table[(BASE_MAX_BYTES >> 7) + 1] = {0};
+#ifdef KZALLOC_EXTENDED_CLASSES
+static constexpr size_t HUGE_LOOKUP_SHIFT = 14;
+inline uint16_t _huge_lookup_table[(MAX_BYTES >> HUGE_LOOKUP_SHIFT) + 1] = {0};
+#endif
+// 为桶选择 Span 页数时允许的最大 Span (1MB，与 PageCache 的小 Span 上限一致)
+// 扩展规格中 1MB 以上的对象一个 Span 只放一个，页数由对象大小决定，不受此限制
+static constexpr size_t MAX_CLASS_SPAN_PAGES = 128;
 namespace SizeUtils {
 
 namespace detail {
@@ -197,8 +359,9 @@ namespace detail {
     }
 
     // 根据当前桶的大小，决定下一个桶应该大多少
-    // 只有在 Init 时调用，稍微多几个 if-else 没关系
-    inline static size_t _CalculateNextBlockSize(size_t current_size) {
+    // 只在编译期建表时调用，稍微多几个 if-else 没关系
+    // constexpr：BasicAllocator 在编译期用它数出自己的桶数
+    inline static constexpr size_t _CalculateNextBlockSize(size_t current_size) {
         // [1, 128] -> 8B 对齐
         // 注意：这里判断的是 current_size，即“上一个桶的大小”
         if (current_size < 128) {
@@ -217,19 +380,123 @@ namespace detail {
             return current_size + 512;
         }
         // [64K, 256K] -> 8KB 对齐
-        else {
+        else if (current_size < BASE_MAX_BYTES) {
             return current_size + 8 * 1024;
         }
+        // 扩展规格：[256K, 1M] -> 16KB 对齐，[1M, 2M] -> 64KB 对齐
+        else if (current_size < 1024 * 1024) {
+            return current_size + 16 * 1024;
+        }
+        else {
+            return current_size + 64 * 1024;
+        }
+    }
+
+    // 旧的经验公式：一次批发 min(512, 256KB/size) 个对象所需的页数
+    // 作为选择 Span 页数的基准值
+    // SHIFT 是页偏移位数，BasicAllocator 的独立堆按自己的页大小计算
+    template <size_t SHIFT = PAGE_SHIFT>
+    inline static constexpr size_t _HeuristicPages(size_t size) {
+        size_t num = BATCH_BYTES / size;
+        if (num == 0) num = 1;
+        if (num > 512) num = 512;
+        size_t npage = (num * size) >> SHIFT;
+        if (npage == 0) npage = 1;
+        return npage;
+    }
+
+    // 在 [基准/2, min(基准*2, MAX_CLASS_SPAN_PAGES)] 中选择尾部浪费比例最小的页数
+    // 浪费比例相同时选离基准最近的，尽量不改变原有的批发粒度
+    // 例如 3200B：基准 31 页尾部浪费 2752B，而 25 页恰好切成 64 个对象，零浪费
+    template <size_t SHIFT = PAGE_SHIFT>
+    inline static constexpr size_t _CalculateSpanPages(size_t size) {
+        size_t base = _HeuristicPages<SHIFT>(size);
+        size_t lo = (base + 1) >> 1;
+        size_t hi = base << 1;
+        if (hi > MAX_CLASS_SPAN_PAGES) hi = MAX_CLASS_SPAN_PAGES;
+        if (hi < base) hi = base;
+        // 至少能放下一个对象
+        size_t minPages = (size + ((size_t)1 << SHIFT) - 1) >> SHIFT;
+        if (lo < minPages) lo = minPages;
+
+        size_t best = base;
+        size_t bestWaste = ((base << SHIFT) % size);
+        size_t bestSpan = base << SHIFT;
+        for (size_t n = lo; n <= hi; ++n) {
+            size_t span = n << SHIFT;
+            size_t waste = span % size;
+            // 比较 waste / span (交叉相乘，避免浮点)
+            size_t lhs = waste * bestSpan;
+            size_t rhs = bestWaste * span;
+            size_t dist = n > base ? n - base : base - n;
+            size_t bestDist = best > base ? best - base : base - best;
+            if (lhs < rhs || (lhs == rhs && dist < bestDist)) {
+                best = n;
+                bestWaste = waste;
+                bestSpan = span;
+            }
+        }
+        return best;
+    }
+
+    // 生成前 N 个桶的大小，从第一个对齐数 8 开始
+    // 全局堆与 BasicAllocator 共用，两边的规格永远一致
+    template <size_t N>
+    inline static constexpr std::array<size_t, N> _BuildClassToSize() {
+        std::array<size_t, N> table{};
+        size_t block_size = 8;
+        for (size_t index = 0; index < N; ++index) {
+            table[index] = block_size;
+            block_size = _CalculateNextBlockSize(block_size);
+        }
+        return table;
+    }
+
+    // 每个桶的 Span 页数，SHIFT 为所在堆的页偏移位数
+    template <size_t SHIFT, size_t N>
+    inline static constexpr std::array<size_t, N> _BuildClassToPages(const std::array<size_t, N>& sizes) {
+        std::array<size_t, N> table{};
+        for (size_t index = 0; index < N; ++index) {
+            table[index] = _CalculateSpanPages<SHIFT>(sizes[index]);
+        }
+        return table;
+    }
+
+    // 线程本地链表一次最多从中心层取多少个 size 大小的对象：BATCH_BYTES / size
+    // 限制范围 [2, 32768]
+    // 扩展规格 (超过 BATCH_BYTES) 例外：上限为 1，ThreadCache 每个桶最多留一个，
+    // 同一大小反复申请释放时命中本地缓存，又不会囤积成百上千 MB
+    inline static constexpr size_t _NumMoveSize(size_t size) {
+        size_t num = BATCH_BYTES / size;
+        if (num == 0) num = 1;
+        else if (num < 2) num = 2;
+        if (num > 32768) num = 32768;
+        return num;
     }
 }
+
+// 规格表在编译期算好：页数搜索每个桶要试上百个候选，放在 Init 里会直接算进首次 malloc 的延迟
+inline constexpr std::array<size_t, MAX_NFREELISTS> _class_to_size = detail::_BuildClassToSize<MAX_NFREELISTS>();
+static_assert(_class_to_size[MAX_NFREELISTS - 1] == MAX_BYTES, "size classes must end at MAX_BYTES");
+// 每个桶向 PageHeap 申请的 Span 页数 (按尾部浪费最小选择)
+inline constexpr std::array<size_t, MAX_NFREELISTS> _class_to_pages = detail::_BuildClassToPages<PAGE_SHIFT>(_class_to_size);
+
     // ---------------------------------------------------------
     // 核心热点函数 (Hot Path) - 全部 O(1)
     // ---------------------------------------------------------
 
-    // 1. 输入 size，返回对应的桶编号 (0 ~ 263)
+    // 1. 输入 size，返回对应的桶编号 (0 ~ MAX_NFREELISTS - 1)
     inline static int Index(size_t size) {
         assert(size <= MAX_BYTES);
-        return _size_lookup_table[size];
+        if (size <= SMALL_LOOKUP_MAX) [[likely]] {
+            return _small_lookup_table[(size + 7) >> 3];
+        }
+#ifdef KZALLOC_EXTENDED_CLASSES
+        if (size > BASE_MAX_BYTES) [[unlikely]] {
+            return _huge_lookup_table[(size + (1 << HUGE_LOOKUP_SHIFT) - 1) >> HUGE_LOOKUP_SHIFT];
+        }
+#endif
+        return _large_lookup_table[(size + 127) >> 7];
     }
 
     // 2. 输入 size，返回对齐后的大小 (例如输入 13 返回 16)
@@ -246,14 +513,55 @@ namespace detail {
         return _class_to_size[index];
     }
 
+    // 4. 获取某个桶每次向 PageHeap 申请的 Span 页数
+    inline static size_t NumPages(size_t index) {
+        assert(index < MAX_NFREELISTS);
+        return _class_to_pages[index];
+    }
+
+    // 5. 获取某个桶每个 Span 尾部切不出对象而浪费的字节数
+    inline static size_t SpanWaste(size_t index) {
+        assert(index < MAX_NFREELISTS);
+        return (_class_to_pages[index] << PAGE_SHIFT) % _class_to_size[index];
+    }
+
+    // 6. 对齐保证 (文档化的性质，aligned_alloc 依赖它)
+    // Span 从页边界开始，桶内对象从 Span 起点按对象大小依次切分 (尾部浪费只在末尾)，
+    // 因此第 k 个对象的地址 = 页边界 + k * 对象大小：
+    // 桶内每个对象都按 min(对象大小的最大 2 的幂因子, PAGE_SIZE) 对齐
+    // 特别地，8B ~ 8KB 的 2 的幂规格都是独立的桶，它们的对象天然按自身大小对齐
+    inline static size_t ClassAlignment(size_t index) {
+        size_t size = Size(index);
+        size_t align = size & (~size + 1); // 最低位的 1
+        return align < PAGE_SIZE ? align : PAGE_SIZE;
+    }
+
+    // 按 alignment (2 的幂，不超过 PAGE_SIZE) 对齐的申请应使用的大小：
+    // 向上取整到 alignment 的整数倍。各区间的桶都是区间步长的整数倍，且覆盖区间内步长的全部整数倍，
+    // 所以取整后的大小所在的桶一定是 alignment 的整数倍 (Init 中有断言)，直接走普通快速路径
+    inline static size_t AlignedSize(size_t alignment, size_t size) {
+        if (size < alignment) size = alignment;
+        return (size + alignment - 1) & ~(alignment - 1);
+    }
+
+    // 7. malloc_isolated 使用的规格：按隔离粒度对齐
+    // 对象从粒度边界开始、大小是粒度的整数倍，独占若干个完整的粒度块，不会与任何邻居共享缓存行
+    inline static size_t IsolatedSize(size_t size) {
+        return AlignedSize(KZALLOC_ISOLATION_BYTES, size);
+    }
+
+    // 专用隔离规格 (size <= ISOLATED_MAX_BYTES)：第 i 个规格的大小是 (i + 1) 个粒度
+    inline static size_t IsolatedIndex(size_t size) {
+        assert(size <= ISOLATED_MAX_BYTES);
+        return size <= KZALLOC_ISOLATION_BYTES ? 0 : (size - 1) / KZALLOC_ISOLATION_BYTES;
+    }
+    inline static size_t IsolatedClassSize(size_t index) {
+        return (index + 1) * KZALLOC_ISOLATION_BYTES;
+    }
+
     inline static size_t NumMoveSize(size_t index) {
         assert(index >= 0);
-        // 计算上限：256KB / size
-        size_t num = MAX_BYTES / _class_to_size[index];
-        // 限制范围 [2, 512]
-        if (num < 2) num = 2;
-        if (num > 32768) num = 32768;
-        return num;
+        return detail::_NumMoveSize(_class_to_size[index]);
     }
 
     // ---------------------------------------------------------
@@ -262,31 +570,40 @@ namespace detail {
     inline static void Init() {
         static std::once_flag flag;
         std::call_once(flag, []() {
-            // 初始化映射表
+            // 桶大小与 Span 页数已在编译期生成 (_class_to_size / _class_to_pages)
+            // 这里只填充两级查找表：每个格子取能容纳该格子上界的最小桶
             int index = 0;
-            // block_size: 当前桶的大小，初始为第一个对齐数 8
-            size_t block_size = 8;
-
-            for (size_t i = 1; i <= MAX_BYTES; ++i) {
-                // 如果当前申请的大小 i 超过了当前桶的大小 block_size
-                // 说明必须要升级到下一个桶了
-                if (i > block_size) {
-                    index++;
-                    // 计算下一个桶的大小应该是多少
-                    block_size = detail::_CalculateNextBlockSize(block_size);
-                }
-                
-                // 填充：用户申请 i 字节 -> 对应第 index 个桶
-                _size_lookup_table[i] = static_cast<uint16_t>(index);
-                
-                // 填充：第 index 个桶 -> 实际大小是 block_size
-                // 只要 index 没变，这里会重复赋值，没关系
-                if (index < MAX_NFREELISTS) {
-                    _class_to_size[index] = block_size;
+            for (size_t i = 0; i <= (SMALL_LOOKUP_MAX >> 3); ++i) {
+                size_t size = i << 3;
+                while (_class_to_size[index] < size) index++;
+                _small_lookup_table[i] = static_cast<uint16_t>(index);
+            }
+
+            index = 0;
+            for (size_t i = 0; i <= (BASE_MAX_BYTES >> 7); ++i) {
+                size_t size = i << 7;
+                while (_class_to_size[index] < size) index++;
+                _large_lookup_table[i] = static_cast<uint16_t>(index);
+            }
+
+#ifdef KZALLOC_EXTENDED_CLASSES
+            index = 0;
+            for (size_t i = 0; i <= (MAX_BYTES >> HUGE_LOOKUP_SHIFT); ++i) {
+                size_t size = i << HUGE_LOOKUP_SHIFT;
+                while (_class_to_size[index] < size) index++;
+                _huge_lookup_table[i] = static_cast<uint16_t>(index);
+            }
+#endif
+
+#ifndef NDEBUG
+            // 对齐保证的前提：2 的幂规格都是独立的桶，且 alignment 的每个整数倍都落在 alignment 整数倍的桶里
+            for (size_t align = 8; align <= PAGE_SIZE; align <<= 1) {
+                assert(_class_to_size[Index(align)] == align);
+                for (size_t size = align; size <= MAX_BYTES; size += align) {
+                    assert(ClassAlignment(Index(size)) >= align);
                 }
             }
-            // 简单处理 size=0 的情况
-             _size_lookup_table[0] = 0;
+#endif
         });
     }
 
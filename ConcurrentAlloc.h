@@ -59,6 +59,7 @@ static inline void* malloc(size_t size) {
         Span* span = PageHeap::GetInstance()->NewSpan(kPages);
         span->_objSize = alignSize;
         span->_isUse = true;
+        tls_manager.Get()->AccountAlloc(alignSize);
 
         // 计算返回地址
         void* ptr = (void*)(span->_pageId << PAGE_SHIFT);
@@ -77,6 +78,86 @@ static inline void* malloc(size_t size) {
     return tls_manager.Get()->Allocate(size);
 }
 
+// ==========================================================
+// 生命周期提示
+// 同一 size class 的对象默认共用 Span，少量长寿命对象会让大批短命邻居释放后
+// Span 仍无法归还 (一个存活对象钉住整个 Span)。调用方知道对象会长期存活时
+// (缓存、连接表、全局索引等)，用 KZ_LONG_LIVED 把它放进单独的 Span 池
+// 释放不需要提示：free(ptr) 根据 Span 自动送回对应的池；
+// sized free 会先进普通链表，归还 CentralCache 时再按 Span 分流，结果同样正确
+// ==========================================================
+enum LifetimeHint : int {
+    KZ_SHORT_LIVED = 0, // 默认，与 malloc 相同
+    KZ_LONG_LIVED = 1,  // 预计长期存活
+};
+
+static inline void* malloc_hint(size_t size, int hint) {
+    // 大对象独占 Span，不存在混居问题
+    if (hint == KZ_LONG_LIVED && size <= MAX_BYTES) {
+        return tls_manager.Get()->AllocateLongLived(size);
+    }
+    return KzAlloc::malloc(size);
+}
+
+// ==========================================================
+// 缓存行隔离
+// 同一规格的小对象在 Span 中紧挨着切分、成批发给各线程，两个线程的计数器或锁字
+// 可能落在同一个缓存行上 (伪共享)。malloc_isolated 返回的块从 KZALLOC_ISOLATION_BYTES
+// 边界开始，独占完整的隔离粒度块，调用方不用自己填充：
+// - 不超过 ISOLATED_MAX_BYTES：专用的隔离规格 (粒度的整数倍)，有自己的本地链表和 CentralCache
+//   Span 池，Span 按规格步长切分，不与普通申请混居
+// - 更大的：取整到粒度的整数倍 (见 SizeUtils::IsolatedSize) 后走普通规格，
+//   这些规格天然按粒度对齐 (SizeUtils::ClassAlignment)；超过 MAX_BYTES 的按页对齐
+// 释放可以用 free(ptr)，或用 free_isolated(ptr, size) 跳过 PageMap 查找；
+// 不要用 free(ptr, size)：隔离规格不一定是普通规格，sized free 会把块挂进按普通规格计算的链表
+// ==========================================================
+static inline void* malloc_isolated(size_t size) {
+    if (size <= ISOLATED_MAX_BYTES) [[likely]] {
+        return tls_manager.Get()->AllocateIsolated(size);
+    }
+    // 大对象按页对齐，天然隔离
+    if (size > MAX_BYTES) [[unlikely]] {
+        return KzAlloc::malloc(size);
+    }
+    return KzAlloc::malloc(SizeUtils::IsolatedSize(size));
+}
+
+// ==========================================================
+// 对齐申请
+// alignment 不超过 PAGE_SIZE 时利用桶的天然对齐 (SizeUtils::ClassAlignment)：
+// 把大小取整到 alignment 的整数倍后走普通的 ThreadCache 快速路径，不额外多申请再手动对齐
+// 大对象的 Span 本来就按页对齐
+// alignment 不是 2 的幂或超过 PAGE_SIZE 时返回 nullptr (与 C11 aligned_alloc 一样视为不支持)
+// 释放用 free(ptr)，或 free_aligned_sized(ptr, alignment, size)；
+// 不能用 free(ptr, size)：原始 size 可能对应另一个桶
+// ==========================================================
+static inline void* aligned_alloc(size_t alignment, size_t size) {
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0 || alignment > PAGE_SIZE) [[unlikely]] {
+        return nullptr;
+    }
+    if (size > MAX_BYTES) [[unlikely]] {
+        return KzAlloc::malloc(size);
+    }
+    return KzAlloc::malloc(SizeUtils::AlignedSize(alignment, size));
+}
+
+// ==========================================================
+// 协程帧
+// 供 KzPromiseAllocator (KzCoroutine.h) 使用：先查本线程的帧回收链表
+// (见 ThreadCache::AllocateFrame)，未命中再走普通的 ThreadCache 路径
+// 释放用 free_frame(ptr, size)，size 与申请时相同；也可以用 free(ptr)
+// ==========================================================
+static inline void* malloc_frame(size_t size) {
+    if (size > MAX_BYTES) [[unlikely]] {
+        return KzAlloc::malloc(size);
+    }
+    return tls_manager.Get()->AllocateFrame(size);
+}
+
+// 释放接口前置声明 (realloc 中需要调用)
+static inline void free(void* ptr);
+static inline void free(void* ptr, size_t size);
+
 // ==========================================================
 // 1. 优化版 Realloc (Sized Realloc)
 // 场景：STL 容器扩容，或者用户知道原始大小
@@ -87,7 +168,7 @@ static inline void* realloc(void* ptr, size_t old_size, size_t new_size) {
     if (ptr == nullptr) [[unlikely]] {
         return KzAlloc::malloc(new_size);
     }
-    if (new_size == 0) [[uhnlikely]] {
+    if (new_size == 0) [[unlikely]] {
         KzAlloc::free(ptr, old_size);
         return nullptr;
     }
@@ -133,7 +214,7 @@ static inline void* realloc(void* ptr, size_t old_size, size_t new_size) {
 static inline void* realloc(void* ptr, size_t new_size) {
     if (ptr == nullptr) [[unlikely]] return KzAlloc::malloc(new_size);
     if (new_size == 0) [[unlikely]] {
-        KzAlloc:free(ptr);
+        KzAlloc::free(ptr);
         return nullptr;
     }
 
@@ -145,6 +226,17 @@ static inline void* realloc(void* ptr, size_t new_size) {
     // 获取 Span 记录的对象大小 (这是对齐后的大小，例如 16)
     size_t old_aligned_size = span->_objSize;
 
+    // 隔离规格不一定是普通规格 (例如 136B)，不能交给按普通规格判断原地复用、做 sized free 的优化版
+    if (span->_isolated) [[unlikely]] {
+        if (new_size <= old_aligned_size) return ptr;
+        void* new_ptr = KzAlloc::malloc(new_size);
+        if (new_ptr != nullptr) {
+            std::memcpy(new_ptr, ptr, old_aligned_size);
+            KzAlloc::free(ptr);
+        }
+        return new_ptr;
+    }
+
     // 复用优化版逻辑
     // 注意：这里传入 old_aligned_size 作为 old_size
     // memcpy 会拷贝整个对齐块 (包括 padding)，这是安全的
@@ -169,6 +261,7 @@ static inline void free(void* ptr) {
         // 2. 判断是大内存还是小内存
         if (size > MAX_BYTES) [[unlikely]] {
             // 大内存：直接还给 PageHeap
+            tls_manager.Get()->AccountFree(size);
             PageHeap::GetInstance()->ReleaseSpan(span);
         } else {
             // 小内存：还给 ThreadCache
@@ -179,7 +272,13 @@ static inline void free(void* ptr) {
                  pTLSThreadCache = static_cast<ThreadCache*>(CreateThreadCache());
             }
                  */
-            tls_manager.Get()->Deallocate(ptr, size);
+            if (span->_longLived) [[unlikely]] {
+                tls_manager.Get()->DeallocateLongLived(ptr, size);
+            } else if (span->_isolated) [[unlikely]] {
+                tls_manager.Get()->DeallocateIsolated(ptr, size);
+            } else {
+                tls_manager.Get()->Deallocate(ptr, size);
+            }
         }
     } else {
         assert(false); // 提醒用户释放了非法地址
@@ -198,4 +297,78 @@ static inline void free(void* ptr, size_t size) {
         tls_manager.Get()->Deallocate(ptr, size);
 }
 
+// size 为申请时传给 malloc_isolated 的大小
+static inline void free_isolated(void* ptr, size_t size) {
+    if (size <= ISOLATED_MAX_BYTES) [[likely]] {
+        tls_manager.Get()->DeallocateIsolated(ptr, size);
+        return;
+    }
+    if (size > MAX_BYTES) [[unlikely]] {
+        KzAlloc::free(ptr);
+        return;
+    }
+    KzAlloc::free(ptr, SizeUtils::IsolatedSize(size));
+}
+
+static inline void free_frame(void* ptr, size_t size) {
+    if (size > MAX_BYTES) [[unlikely]] {
+        KzAlloc::free(ptr, size);
+        return;
+    }
+    tls_manager.Get()->DeallocateFrame(ptr, size);
+}
+
+// alignment / size 与 aligned_alloc 时相同 (C23 free_aligned_sized 的语义)
+static inline void free_aligned_sized(void* ptr, size_t alignment, size_t size) {
+    if (size > MAX_BYTES) [[unlikely]] {
+        KzAlloc::free(ptr);
+        return;
+    }
+    KzAlloc::free(ptr, SizeUtils::AlignedSize(alignment, size));
+}
+
+// ==========================================================
+// 统计接口
+// 只读取各处发布的 Seqlock 快照和原子计数，不加分片锁/桶锁，
+// 监控线程可以高频轮询而不影响分配路径
+// ==========================================================
+struct AllocatorStats {
+    ReleaseStats pages;        // PageHeap：各分片快照之和
+    EmptySpanStats emptySpans; // CentralCache：空 Span 缓存
+    ThreadCounters threads;    // 所有线程 (含已退出的) 的计数之和
+    size_t liveThreads = 0;    // 当前持有 ThreadCache 的线程数
+};
+
+static inline AllocatorStats GetStats() {
+    AllocatorStats stats;
+    stats.pages = PageHeap::GetInstance()->SnapshotReleaseStats();
+    stats.emptySpans = CentralCache::GetInstance()->GetEmptySpanStats();
+    stats.threads = ThreadStatsRegistry::GetInstance()->Total(&stats.liveThreads);
+    return stats;
+}
+
+// 当前线程的计数：累计申请/释放字节数 (实时) 与慢速路径计数
+static inline ThreadCounters ThreadStats() {
+    return tls_manager.Get()->Stats();
+}
+
+// 遍历所有存活线程的计数：fn(tid, const ThreadCounters&)
+// 无锁读取，可以在任意线程调用；已退出线程的量并入 GetStats().threads
+// 字节计数是各线程最近一次发布的值：慢速路径上或该线程调用 ThreadStats() 时发布
+template <typename Fn>
+static inline void ForEachThreadStats(Fn&& fn) {
+    ThreadStatsRegistry::GetInstance()->ForEachThread(std::forward<Fn>(fn));
+}
+
+// 为当前线程设置软配额：净申请字节数超过 quotaBytes 时调用 callback (不拒绝分配)
+// quotaBytes 为 0 或 callback 为空表示取消
+static inline void SetThreadQuota(size_t quotaBytes, ThreadQuotaCallback callback, void* context = nullptr) {
+    tls_manager.Get()->SetQuota(quotaBytes, callback, context);
+}
+
+// 导出堆布局 (每个 Span 一行 JSON)，配合 tools/heap_analyze 离线分析碎片
+static inline bool DumpHeap(int fd) {
+    return PageHeap::GetInstance()->DumpHeap(fd);
+}
+
 } // namespace KzAlloc
\ No newline at end of file
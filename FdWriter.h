@@ -0,0 +1,60 @@
+#pragma once
+#include "Common.h"
+#include <cstdio>
+#include <cerrno>
+#include <algorithm>
+
+namespace KzAlloc {
+
+// =========================================================================
+// FdWriter
+// 诊断输出 (DumpHeap、统计报告) 用的小缓冲写入器：
+// snprintf 到内嵌缓冲区，攒满后直接 write(fd)，全程不分配内存
+// 写入失败后后续输出全部丢弃，由 Flush 的返回值告知调用方
+// =========================================================================
+class FdWriter {
+public:
+    explicit FdWriter(int fd) : _fd(fd) {}
+    ~FdWriter() { Flush(); }
+
+    template <typename... Args>
+    void Line(const char* fmt, Args... args) {
+        if (_failed) return;
+        if (sizeof(_buf) - _len < LINE_MAX_BYTES) Flush();
+        size_t avail = sizeof(_buf) - _len;
+        int n = std::snprintf(_buf + _len, avail, fmt, args...);
+        // 单行超过 LINE_MAX_BYTES 时被截断
+        if (n > 0) _len += std::min(static_cast<size_t>(n), avail - 1);
+    }
+
+    bool Flush() {
+#ifdef _WIN32
+        _len = 0;
+        _failed = true;
+#else
+        size_t off = 0;
+        while (off < _len && !_failed) {
+            ssize_t n = write(_fd, _buf + off, _len - off);
+            if (n > 0) {
+                off += static_cast<size_t>(n);
+            } else if (n < 0 && errno == EINTR) {
+                continue;
+            } else {
+                _failed = true;
+            }
+        }
+        _len = 0;
+#endif
+        return !_failed;
+    }
+
+private:
+    static constexpr size_t LINE_MAX_BYTES = 512;
+
+    int _fd;
+    char _buf[16 * 1024];
+    size_t _len = 0;
+    bool _failed = false;
+};
+
+} // namespace KzAlloc
@@ -0,0 +1,69 @@
+#include "PageCache.h"
+#include "PageMap.h"
+#include "FdWriter.h"
+
+namespace KzAlloc {
+
+// =========================================================================
+// DumpHeap (堆布局导出)
+// 每行一个 JSON 对象 (JSON Lines)，便于 grep 与离线分析 (tools/heap_analyze.cpp)：
+//   {"type":"header",...}             一行，记录页大小、分片数等解析所需的常量
+//   {"type":"span",...}               每个 Span 一行，按页号升序
+//   {"type":"footer",...}             一行，记录 Span 总数，用于校验文件是否完整
+// 导出期间持有全部分片锁 (页级别的申请/归还会等待)，只应在诊断时调用
+// 小对象 Span 的 use 由 CentralCache 在桶锁下维护，这里不加桶锁，读到的是近似值
+// 不分配内存：用 FdWriter 格式化到缓冲区，攒满后 write
+// =========================================================================
+
+namespace {
+
+const char* SpanState(const Span* span) {
+    if (span->_isUse) return "in_use";
+    if (span->_isCold) return "cold";
+    return "hot";
+}
+
+} // namespace
+
+bool PageHeap::DumpHeap(int fd) {
+    // 1. 禁止新分片构造，再按分片下标升序加锁 (与 StealSpan 的 try_lock 不会形成死锁)
+    std::lock_guard<SpinMutex> initLock(_initMtx);
+    for (size_t i = 0; i < _shardCount; ++i) {
+        if (_shardReady[i].load(std::memory_order_acquire)) {
+            _shards[i].GetMutex().lock();
+        }
+    }
+
+    FdWriter out(fd);
+    out.Line("{\"type\":\"header\",\"version\":1,\"page_shift\":%zu,\"max_bytes\":%zu,\"shards\":%zu}\n",
+             PAGE_SHIFT, MAX_BYTES, _shardCount);
+
+    // 2. 遍历 PageMap：每个 Span 恰好出现一次
+    size_t spans = 0;
+    PageMap::GetInstance()->ForEachSpan([&](const Span* span) {
+        long long sizeClass = -1;
+        if (span->_isUse && span->_objSize > 0 && span->_objSize <= MAX_BYTES) {
+            sizeClass = SizeUtils::Index(span->_objSize);
+        }
+        out.Line("{\"type\":\"span\",\"page\":%llu,\"pages\":%zu,\"state\":\"%s\",\"shard\":%u,"
+                 "\"obj_size\":%zu,\"class\":%lld,\"use\":%zu,\"objs\":%zu,\"released\":%zu,\"long_lived\":%d}\n",
+                 static_cast<unsigned long long>(span->_pageId), span->_n, SpanState(span),
+                 static_cast<unsigned>(span->_shardId), span->_isUse ? span->_objSize : 0, sizeClass,
+                 span->_isUse ? span->_useCount : 0, span->_isUse ? span->_objCount : 0,
+                 span->_isUse ? 0 : span->_releasedPages, sizeClass >= 0 && span->_longLived ? 1 : 0);
+        ++spans;
+    });
+
+    out.Line("{\"type\":\"footer\",\"spans\":%zu}\n", spans);
+    bool ok = out.Flush();
+
+    for (size_t i = _shardCount; i-- > 0;) {
+        if (_shardReady[i].load(std::memory_order_acquire)) {
+            _shards[i].GetMutex().unlock();
+            _shards[i].DrainReturnQueueAfterUnlock();
+        }
+    }
+    return ok;
+}
+
+} // namespace KzAlloc
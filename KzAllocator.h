@@ -2,11 +2,31 @@
 
 #include "ConcurrentAlloc.h"
 #include <limits>
+#include <type_traits>
 #include <utility>
 
 namespace KzAlloc {
 
-template <class T>
+// =========================================================================
+// 放置策略 (KzAllocator 的第二个模板参数)
+// 决定容器的内存块从哪种规格里分配；同一策略的分配器实例都等价
+// =========================================================================
+
+// 默认：普通 size class，对象紧挨着切分
+struct DefaultPlacement {
+    static void* Allocate(size_t bytes) { return KzAlloc::malloc(bytes); }
+    static void Deallocate(void* p, size_t bytes) { KzAlloc::free(p, bytes); }
+};
+
+// 缓存行隔离：每次 allocate 得到的块独占完整的隔离粒度块 (见 malloc_isolated)
+// 隔离的是"每次 allocate 的块"：vector 的整个数组与别人隔开，元素之间并不隔开；
+// 需要逐个对象隔离时用于 list/map 节点、allocate_shared 等每次只分配一个对象的场景
+struct IsolatedPlacement {
+    static void* Allocate(size_t bytes) { return KzAlloc::malloc_isolated(bytes); }
+    static void Deallocate(void* p, size_t bytes) { KzAlloc::free_isolated(p, bytes); }
+};
+
+template <class T, class Placement = DefaultPlacement>
 class KzAllocator {
 public:
     // STL 标准类型定义
@@ -18,18 +38,20 @@ public:
     using size_type = std::size_t;
     using difference_type = std::ptrdiff_t;
 
+    using placement = Placement;
+
     // 核心：Rebind 结构
-    // 告诉 STL 如何把 KzAllocator<T> 变成 KzAllocator<U>
+    // 告诉 STL 如何把 KzAllocator<T> 变成 KzAllocator<U> (放置策略保持不变)
     template <class U>
     struct rebind {
-        using other = KzAllocator<U>;
+        using other = KzAllocator<U, Placement>;
     };
 
     // 构造函数
     KzAllocator() noexcept {}
     
     template <class U>
-    KzAllocator(const KzAllocator<U>&) noexcept {}
+    KzAllocator(const KzAllocator<U, Placement>&) noexcept {}
 
     ~KzAllocator() {}
 
@@ -44,7 +66,7 @@ public:
         }
         
         // 调用我们的高并发内存池
-        if (void* ptr = KzAlloc::malloc(n * sizeof(T))) {
+        if (void* ptr = Placement::Allocate(n * sizeof(T))) {
             return static_cast<T*>(ptr);
         }
         
@@ -53,7 +75,7 @@ public:
 
     // 释放内存
     void deallocate(T* p, size_t n) noexcept {
-        KzAlloc::free(p, n * sizeof(T));
+        Placement::Deallocate(p, n * sizeof(T));
     }
 
     // 对象构造 (Placement New)
@@ -69,16 +91,21 @@ public:
     }
 };
 
+// 缓存行隔离的分配器
+template <class T>
+using KzIsolatedAllocator = KzAllocator<T, IsolatedPlacement>;
+
 // 比较运算符
-// 因为我们是全局单例模式，所有分配器实例都是等价的
-template <class T, class U>
-bool operator==(const KzAllocator<T>&, const KzAllocator<U>&) {
-    return true;
+// 因为我们是全局单例模式，同一放置策略的分配器实例都是等价的
+// 不同策略之间不能互相释放 (sized free 的规格不同)
+template <class T, class U, class P1, class P2>
+bool operator==(const KzAllocator<T, P1>&, const KzAllocator<U, P2>&) {
+    return std::is_same<P1, P2>::value;
 }
 
-template <class T, class U>
-bool operator!=(const KzAllocator<T>&, const KzAllocator<U>&) {
-    return false;
+template <class T, class U, class P1, class P2>
+bool operator!=(const KzAllocator<T, P1>&, const KzAllocator<U, P2>&) {
+    return !std::is_same<P1, P2>::value;
 }
 
 } // namespace KzAlloc
\ No newline at end of file
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "ConcurrentAlloc.h"
+#include <cstddef>
+
+namespace KzAlloc {
+
+// =========================================================================
+// 协程帧分配器 (promise_type 的基类)
+// C++20 协程帧默认经全局 operator new 分配；promise_type 继承 KzPromiseAllocator 后，
+// 编译器改用这里的 operator new 与 sized operator delete：
+// 1. 帧从 ThreadCache 分配，释放时编译器传入帧大小，不查 PageMap
+// 2. 每个线程为最常见的几种帧大小保留短回收链表 (ThreadCache::AllocateFrame)，
+//    同一种协程反复创建销毁时只是一次链表弹出/压入
+// 用法：
+//   struct Task {
+//       struct promise_type : KzAlloc::KzPromiseAllocator { ... };
+//   };
+// 只提供 operator new(size_t)：协程参数不参与分配；
+// 没有 get_return_object_on_allocation_failure，分配失败时与 new 一样抛 std::bad_alloc
+// =========================================================================
+struct KzPromiseAllocator {
+    static void* operator new(std::size_t size) {
+        return KzAlloc::malloc_frame(size);
+    }
+
+    static void operator delete(void* ptr, std::size_t size) noexcept {
+        KzAlloc::free_frame(ptr, size);
+    }
+};
+
+} // namespace KzAlloc
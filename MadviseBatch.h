@@ -0,0 +1,163 @@
+#pragma once
+#include "Common.h"
+#include <algorithm>
+#include <atomic>
+
+#ifndef _WIN32
+#include <sys/uio.h>
+#include <cerrno>
+#endif
+
+namespace KzAlloc {
+
+// =========================================================================
+// MadviseBatch (批量归还)
+// ReleaseSomeSpansToSystem 一轮可能归还几十上百个小页段，逐段 madvise 就是逐段系统调用，
+// 每次都要拿一次 mmap 锁。这里先把待归还的页段攒起来：
+// 1. Flush 时按地址排序，首尾相接的页段合并成一段
+// 2. 内核支持时用 process_madvise 一次提交整个 iovec 数组，否则退回逐段 madvise
+// =========================================================================
+
+// 一批最多容纳的页段数 (远小于 IOV_MAX)
+static constexpr size_t MADVISE_BATCH_RANGES = 64;
+
+class MadviseBatch {
+public:
+    MadviseBatch() = default;
+    ~MadviseBatch() { Flush(); }
+
+    MadviseBatch(const MadviseBatch&) = delete;
+    MadviseBatch& operator=(const MadviseBatch&) = delete;
+
+    // 加入一段待归还的页 [id, id + n)
+    void Add(PAGE_ID id, size_t n) {
+        // 与上一段首尾相接时直接延长，省掉一个槽位
+        if (_count > 0 && _ranges[_count - 1].id + _ranges[_count - 1].n == id) {
+            _ranges[_count - 1].n += n;
+            return;
+        }
+        if (_count == MADVISE_BATCH_RANGES) {
+            Flush();
+        }
+        _ranges[_count++] = {id, n};
+    }
+
+    // 提交全部页段，返回本次使用的系统调用次数
+    size_t Flush() {
+        if (_count == 0) return 0;
+
+        // 1. 按地址排序并合并相邻页段
+        std::sort(_ranges, _ranges + _count,
+                  [](const Range& a, const Range& b) { return a.id < b.id; });
+        size_t merged = 0;
+        for (size_t i = 1; i < _count; ++i) {
+            if (_ranges[merged].id + _ranges[merged].n == _ranges[i].id) {
+                _ranges[merged].n += _ranges[i].n;
+            } else {
+                _ranges[++merged] = _ranges[i];
+            }
+        }
+        size_t count = merged + 1;
+        _count = 0;
+
+        // 2. 提交
+        size_t calls = Submit(_ranges, count);
+        _syscalls += calls;
+        return calls;
+    }
+
+    // 累计系统调用次数
+    size_t Syscalls() const { return _syscalls; }
+
+private:
+    struct Range {
+        PAGE_ID id;
+        size_t n;
+    };
+
+    static size_t Submit(const Range* ranges, size_t count) {
+#ifdef _WIN32
+        for (size_t i = 0; i < count; ++i) {
+            VirtualFree((void*)(ranges[i].id << PAGE_SHIFT), ranges[i].n << PAGE_SHIFT, MEM_DECOMMIT);
+        }
+        return count;
+#else
+        if (count > 1 && ProcessMadvise(ranges, count)) {
+            return 1;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            madvise((void*)(ranges[i].id << PAGE_SHIFT), ranges[i].n << PAGE_SHIFT, MADV_DONTNEED);
+        }
+        return count;
+#endif
+    }
+
+#ifndef _WIN32
+    // 尝试用 process_madvise 一次提交，成功返回 true
+    // 旧内核 (< 5.10，或不允许对 MADV_DONTNEED 使用 process_madvise) 第一次失败后就不再尝试
+    static bool ProcessMadvise(const Range* ranges, size_t count) {
+#if defined(SYS_process_madvise) && defined(SYS_pidfd_open)
+        int fd = SelfPidfd();
+        if (fd < 0) return false;
+
+        struct iovec iov[MADVISE_BATCH_RANGES];
+        size_t bytes = 0;
+        for (size_t i = 0; i < count; ++i) {
+            iov[i].iov_base = (void*)(ranges[i].id << PAGE_SHIFT);
+            iov[i].iov_len = ranges[i].n << PAGE_SHIFT;
+            bytes += iov[i].iov_len;
+        }
+
+        long ret = syscall(SYS_process_madvise, fd, iov, count, MADV_DONTNEED, 0);
+        if (ret == (long)bytes) return true;
+        if (ret < 0 && (errno == EINVAL || errno == ENOSYS || errno == EPERM || errno == EBADF)) {
+            // 内核不支持，之后一直走 madvise
+            _pidfd.store(PidfdKey(getpid(), PIDFD_UNSUPPORTED), std::memory_order_release);
+        }
+        // 部分失败或不支持：调用方会对全部页段逐个 madvise，重复 DONTNEED 是无害的
+        return false;
+#else
+        (void)ranges;
+        (void)count;
+        return false;
+#endif
+    }
+
+#if defined(SYS_process_madvise) && defined(SYS_pidfd_open)
+    // 本进程的 pidfd 缓存：高 32 位是打开它的进程 pid，低 32 位是 fd
+    // fork 出的子进程继承的是指向父进程的 pidfd，用它 DONTNEED 的是父进程的页，
+    // 所以按 getpid() 校验，pid 变了就重新打开
+    static constexpr int PIDFD_UNSUPPORTED = -1;
+    static inline std::atomic<uint64_t> _pidfd{0};
+
+    static uint64_t PidfdKey(pid_t pid, int fd) {
+        return ((uint64_t)(uint32_t)pid << 32) | (uint32_t)fd;
+    }
+
+    // 返回本进程的 pidfd，不支持时返回 -1
+    static int SelfPidfd() {
+        pid_t pid = getpid();
+        uint64_t cached = _pidfd.load(std::memory_order_acquire);
+        if ((pid_t)(cached >> 32) == pid) return (int)(uint32_t)cached;
+
+        int opened = (int)syscall(SYS_pidfd_open, pid, 0);
+        uint64_t key = PidfdKey(pid, opened < 0 ? PIDFD_UNSUPPORTED : opened);
+        if (_pidfd.compare_exchange_strong(cached, key, std::memory_order_acq_rel)) {
+            // 换下来的是父进程留下的 pidfd (子进程里这个 fd 号同样有效，关掉避免泄漏)
+            int stale = (int)(uint32_t)cached;
+            if (cached != 0 && stale >= 0) close(stale);
+            return opened < 0 ? PIDFD_UNSUPPORTED : opened;
+        }
+        // 别的线程抢先完成了探测
+        if (opened >= 0) close(opened);
+        return (int)(uint32_t)cached;
+    }
+#endif
+#endif
+
+    Range _ranges[MADVISE_BATCH_RANGES];
+    size_t _count = 0;
+    size_t _syscalls = 0;
+};
+
+} // namespace KzAlloc
@@ -0,0 +1,78 @@
+#pragma once
+#include "Common.h"
+#include "ObjectPool.h"
+#include "SpinLock.h"
+#include <mutex>
+
+namespace KzAlloc {
+
+// =========================================================================
+// Magazine (弹匣)
+// 定容的指针数组，作为 ThreadCache 的可选前端 (编译期宏 KZALLOC_USE_MAGAZINE)
+// 与 FreeList 相比：
+// 1. Push/Pop 只是对数组的下标读写，不写入用户对象内部，不会弄脏用户刚用完的缓存行
+// 2. Pop 没有 NextObj 的依赖加载 (指针追逐)
+// 3. 与 CentralCache 以整只弹匣为单位交换，交换本身是 O(1) 的指针交换
+// =========================================================================
+
+// 每只弹匣最多容纳的对象数 (槽位数组的大小)
+static constexpr size_t MAGAZINE_CAPACITY = 64;
+// 每只弹匣囤积的字节数目标：大对象的弹匣装得少，避免一只弹匣就是几 MB
+static constexpr size_t MAGAZINE_BYTES = 64 * 1024;
+// 每个桶的 Depot 最多囤积多少只满弹匣
+static constexpr size_t MAX_DEPOT_MAGAZINES = 8;
+
+// 某个规格的弹匣容量：MAGAZINE_BYTES / size，夹在 [1, MAGAZINE_CAPACITY]
+inline size_t MagazineCapacity(size_t size) {
+    size_t capacity = MAGAZINE_BYTES / size;
+    if (capacity < 1) capacity = 1;
+    if (capacity > MAGAZINE_CAPACITY) capacity = MAGAZINE_CAPACITY;
+    return capacity;
+}
+
+struct Magazine {
+    Magazine* _next = nullptr; // Depot 中的单向链表
+    size_t _count = 0;
+    size_t _capacity = MAGAZINE_CAPACITY; // 从弹匣池取出时按规格设置
+    void* _slots[MAGAZINE_CAPACITY];
+
+    bool Empty() const { return _count == 0; }
+    bool Full() const { return _count == _capacity; }
+
+    void Push(void* obj) {
+        assert(!Full());
+        _slots[_count++] = obj;
+    }
+
+    void* Pop() {
+        assert(!Empty());
+        return _slots[--_count];
+    }
+
+    // 把弹匣里的对象串成单链表 (只在和 Span 交换时使用)
+    // 返回链表头，end 为链表尾
+    void* Link(void*& end) {
+        assert(!Empty());
+        for (size_t i = 0; i + 1 < _count; ++i) {
+            NextObj(_slots[i]) = _slots[i + 1];
+        }
+        end = _slots[_count - 1];
+        NextObj(end) = nullptr;
+        return _slots[0];
+    }
+};
+
+// 弹匣对象池 (全局共享，绕过 malloc)
+inline ObjectPool<Magazine>& GetMagazinePool() {
+    static ObjectPool<Magazine> pool;
+    return pool;
+}
+
+// 每个桶的满弹匣仓库
+struct alignas(CACHE_LINE_SIZE) MagazineDepot {
+    SpinMutex _mtx;
+    Magazine* _full = nullptr;
+    size_t _fullCount = 0;
+};
+
+} // namespace KzAlloc
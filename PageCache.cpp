@@ -1,7 +1,12 @@
 #include "PageCache.h"
+#include "PressureMonitor.h"
+#include "StatsReporter.h"
 #include <iostream>
 #include <cassert>
 #include <new> // for placement new
+#include <condition_variable>
+#include <cerrno>
+#include <cstring>
 
 namespace KzAlloc {
 
@@ -27,15 +32,22 @@ PageHeap::PageHeap() {
     // 4. 计算路由掩码
     _shardMask = _shardCount - 1;
 
-    // 5. 向 OS 申请裸内存来存放分片数组
+    // 5. 向 OS 申请裸内存来存放分片数组 (后面紧跟每个分片的就绪标记)
+    // 这里只是预留虚拟地址，mmap 的页在第一次写入前不会占用物理内存
     size_t arrayBytes = sizeof(PageCacheShard) * _shardCount;
-    size_t kpages = (arrayBytes + PAGE_SIZE - 1) >> PAGE_SHIFT;
+    size_t totalBytes = arrayBytes + sizeof(std::atomic<bool>) * _shardCount;
+    size_t kpages = (totalBytes + PAGE_SIZE - 1) >> PAGE_SHIFT;
 
     void* ptr = SystemAlloc(kpages);
     _shards = static_cast<PageCacheShard*>(ptr);
+    _shardReady = reinterpret_cast<std::atomic<bool>*>(static_cast<char*>(ptr) + arrayBytes);
+    for (size_t i = 0; i < _shardCount; ++i) {
+        new (&_shardReady[i]) std::atomic<bool>(false);
+    }
 
-    // A. 获取物理内存总字节数
-    size_t totalRam = GetSystemPhysicalMemory();
+    // A. 获取可用内存总字节数 (物理内存与 cgroup v2 限制取小)
+    // 容器里按宿主机内存来算会让缓存远超容器限制，空闲页就会把进程送进 OOM
+    size_t totalRam = GetEffectiveMemoryLimit();
 
     // B. 设定目标：全局最大缓存物理内存的 25%
     //    或者硬限制：全局最大缓存 4GB (看你业务需求，数据库类应用可以设大点，普通应用设小点)
@@ -50,10 +62,15 @@ PageHeap::PageHeap() {
     size_t totalThresholdPages = maxCacheBytes >> PAGE_SHIFT;
 
     // D. 平摊到每个分片
-    // 注意：至少保留一定数量 (例如 512 页 / 4MB)，防止抖动太频繁
+    // 注意：至少保留一定数量 (4096 页 / 32MB)，防止抖动太频繁
+    // 但所有分片的下限加起来不能超过可用内存的 1/8 (小容器 + 多核时下限本身就会撑爆限制)
     size_t shardThreshold = totalThresholdPages / _shardCount;
-    if (shardThreshold < 4096) {
-        shardThreshold = 4096;
+    size_t floorPages = std::min<size_t>(4096, ((totalRam / 8) >> PAGE_SHIFT) / _shardCount);
+    if (floorPages < MIN_RELEASE_THRESHOLD_PAGES) {
+        floorPages = MIN_RELEASE_THRESHOLD_PAGES;
+    }
+    if (shardThreshold < floorPages) {
+        shardThreshold = floorPages;
     }
 
     // E. 通过环境变量配置
@@ -62,35 +79,86 @@ PageHeap::PageHeap() {
         size_t val = std::strtoull(envThreshold, nullptr, 10);
         if (val > 0) {
             shardThreshold = val; // 强行覆盖
+            _adaptiveRelease = false; // 用户显式指定时不再自适应
         }
     }
 
-    // 6. 使用 Placement New 在裸内存上构造对象
+    _shardThreshold = shardThreshold;
+
+    // F. 预缺页：复用的冷 Span 不少于这么多页时，分配时就用 MADV_POPULATE_WRITE 建好映射
+    // 默认关闭 (0)；KZALLOC_POPULATE_ASYNC=1 时交给辅助线程异步完成
+    const char* envPopulate = std::getenv("KZALLOC_POPULATE_THRESHOLD_PAGES");
+    if (envPopulate) {
+        const char* envAsync = std::getenv("KZALLOC_POPULATE_ASYNC");
+        SetPopulateThreshold(std::strtoull(envPopulate, nullptr, 10),
+                             envAsync && std::strtoull(envAsync, nullptr, 10) != 0);
+    }
+
+    // G. 内存压力监控 (可选)：KZALLOC_PSI_PATH=1 使用 /proc/pressure/memory，否则视为文件路径
+    const char* envPsi = std::getenv("KZALLOC_PSI_PATH");
+    if (envPsi && *envPsi) {
+        PressureMonitorOptions options;
+        if (std::strcmp(envPsi, "1") != 0) options.path = envPsi;
+        // 监控线程第一次采样前会先睡一个周期，且它访问 PageHeap 时会等本构造函数结束
+        PressureMonitor::GetInstance()->Start(options);
+    }
+
+    // H. 统计报告 (可选)：KZALLOC_STATS_PATH 为报告路径 ("memfd" 表示匿名内存文件)
+    // 触发方式：KZALLOC_STATS_SIGNAL 指定的信号，或 KZALLOC_STATS_CONTROL 指定的控制文件出现
+    const char* envStats = std::getenv("KZALLOC_STATS_PATH");
+    if (envStats && *envStats) {
+        StatsReporterOptions options;
+        options.outputPath = envStats;
+        const char* envSignal = std::getenv("KZALLOC_STATS_SIGNAL");
+        if (envSignal) options.signalNumber = std::atoi(envSignal);
+        options.controlPath = std::getenv("KZALLOC_STATS_CONTROL");
+        StatsReporter::GetInstance()->Start(options);
+    }
+
+    // 6. 分片不在这里构造，而是在第一次被路由到时由 ConstructShard 构造
+    // 进程只用到少数几个分片时，其余分片永远不会被触碰
+}
+
+void PageHeap::ConstructShard(size_t idx) {
+    std::lock_guard<SpinMutex> lock(_initMtx);
+    if (_shardReady[idx].load(std::memory_order_relaxed)) return;
+
+    // 使用 Placement New 在裸内存上构造对象
     // 这避免了调用全局 new/malloc，解决了递归依赖问题
-    for (size_t i = 0; i < _shardCount; ++i) {
-        // PageCacheShard 的构造函数会初始化内部的 map 和 mutex
-        // 因为 map 使用了 BootstrapAllocator，所以也是安全的
-        new (&_shards[i]) PageCacheShard();
-        // 注入配置
-        _shards[i].SetReleaseThreshold(shardThreshold);
-        // 初始化 Shard ID
-        _shards[i].InitShard(static_cast<uint8_t>(i));
+    // PageCacheShard 的构造函数会初始化内部的 map 和 mutex
+    // 因为 map 使用了 BootstrapAllocator，所以也是安全的
+    new (&_shards[idx]) PageCacheShard();
+    // 注入配置
+    _shards[idx].SetReleaseThreshold(_shardThreshold, _adaptiveRelease);
+    // 初始化 Shard ID
+    _shards[idx].InitShard(static_cast<uint16_t>(idx));
+    if (_underPressure.load(std::memory_order_acquire)) {
+        _shards[idx].SetUnderPressure(true);
     }
+    if (!_quickLists.load(std::memory_order_acquire)) {
+        _shards[idx].SetQuickLists(false);
+    }
+
+    _shardReady[idx].store(true, std::memory_order_release);
 }
 
 PageHeap::~PageHeap() {
     if (_shards) {
-        // 1. 显式调用析构函数
+        // 1. 显式调用析构函数 (只析构真正构造过的分片)
         for (size_t i = 0; i < _shardCount; ++i) {
-            _shards[i].~PageCacheShard();
+            if (_shardReady[i].load(std::memory_order_acquire)) {
+                _shards[i].~PageCacheShard();
+            }
         }
         
         // 2. 归还物理内存
         size_t arrayBytes = sizeof(PageCacheShard) * _shardCount;
-        size_t kpages = (arrayBytes + PAGE_ROUND_UP_NUM) >> PAGE_SHIFT;
+        size_t totalBytes = arrayBytes + sizeof(std::atomic<bool>) * _shardCount;
+        size_t kpages = (totalBytes + PAGE_ROUND_UP_NUM) >> PAGE_SHIFT;
         SystemFree(_shards, kpages);
         
         _shards = nullptr;
+        _shardReady = nullptr;
     }
 }
 
@@ -105,17 +173,145 @@ Span* PageHeap::NewSpan(size_t k) {
     size_t idx = GetShardIndex();
     
     // 路由到指定分片
-    Span* span = _shards[idx].NewSpan(k);
+    size_t faults = 0;
+    Span* span = GetShard(idx).NewSpan(k, &faults);
     
     // 标记出生地
     // 必须在这里标记，因为 Shard 内部不知道自己的 Index
     if (span) {
-        span->_shardId = static_cast<uint8_t>(idx);
+        span->_shardId = static_cast<uint16_t>(idx);
+    }
+
+    // 复用的冷 Span 足够大时预先缺页 (已经出了分片锁)
+    size_t threshold = _populateThreshold.load(std::memory_order_relaxed);
+    if (threshold != 0 && faults != 0 && k >= threshold) [[unlikely]] {
+        PrefaultSpan(span);
     }
     
     return span;
 }
 
+void PageHeap::SetPopulateThreshold(size_t pages, bool async) {
+    _populateAsync.store(async, std::memory_order_relaxed);
+    _populateThreshold.store(pages, std::memory_order_relaxed);
+}
+
+// =========================================================================
+// 预缺页 (MADV_POPULATE_WRITE, Linux 5.14+)
+// 复用冷 Span 时，用户第一次写入每一页都会触发一次缺页 (512KB 就是 64 次)
+// 这里用一次系统调用把整段页面提前建好映射，缺页成本集中在分配时支付，
+// 而不是散落在调用方延迟敏感的写循环里
+// 内容不会被改写：已驻留的页原样保留，未驻留的页映射为零页后写时分配
+// =========================================================================
+#ifndef MADV_POPULATE_WRITE
+#define MADV_POPULATE_WRITE 23
+#endif
+
+namespace {
+
+// 不支持的内核 (EINVAL) 上第一次失败后就不再尝试
+std::atomic<bool> g_populateUnsupported{false};
+
+bool PopulateWrite(PAGE_ID id, size_t n) {
+#ifdef _WIN32
+    (void)id;
+    (void)n;
+    return false;
+#else
+    if (g_populateUnsupported.load(std::memory_order_relaxed)) return false;
+    if (madvise((void*)(id << PAGE_SHIFT), n << PAGE_SHIFT, MADV_POPULATE_WRITE) != 0) {
+        if (errno == EINVAL) g_populateUnsupported.store(true, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+#endif
+}
+
+// 异步预缺页的辅助线程
+// 队列满时直接丢弃请求：预缺页只是优化，用户写入时照样会缺页
+class PrefaultWorker {
+public:
+    static PrefaultWorker* GetInstance() {
+        alignas(PrefaultWorker) static char _buffer[sizeof(PrefaultWorker)];
+        static PrefaultWorker* _instance = nullptr;
+        static const bool _inited = [&]() {
+            _instance = new (_buffer) PrefaultWorker();
+            return true;
+        }();
+        (void)_inited;
+        return _instance;
+    }
+
+    // 返回 false 表示队列已满
+    bool Submit(size_t shard, PAGE_ID id, size_t n) {
+        {
+            std::lock_guard<std::mutex> lock(_mtx);
+            if (_count == QUEUE_SIZE) return false;
+            _queue[(_head + _count) % QUEUE_SIZE] = {shard, id, n};
+            _count++;
+        }
+        _cv.notify_one();
+        return true;
+    }
+
+private:
+    static constexpr size_t QUEUE_SIZE = 64;
+
+    PrefaultWorker() {
+        // 线程永不退出 (分离)，单例也永不析构，进程退出时无需同步
+        std::thread([this]() { Run(); }).detach();
+    }
+
+    void Run() {
+        while (true) {
+            Request req;
+            {
+                std::unique_lock<std::mutex> lock(_mtx);
+                _cv.wait(lock, [this]() { return _count > 0; });
+                req = _queue[_head];
+                _head = (_head + 1) % QUEUE_SIZE;
+                _count--;
+            }
+            // 与用户写入并发是安全的 (POPULATE_WRITE 不改写内容)，
+            // 但请求在队列里等待期间 Span 可能已被释放、madvise 并记入驻留位图，
+            // 这时再预缺页会让位图与实际驻留不符：到分片锁内复核，不在使用就丢弃
+            PageHeap::GetInstance()->PopulateIfInUse(req.shard, req.id, req.n);
+        }
+    }
+
+    struct Request {
+        size_t shard;
+        PAGE_ID id;
+        size_t n;
+    };
+
+    std::mutex _mtx;
+    std::condition_variable _cv;
+    Request _queue[QUEUE_SIZE];
+    size_t _head = 0;
+    size_t _count = 0;
+};
+
+} // namespace
+
+void PageHeap::PrefaultSpan(Span* span) {
+    if (_populateAsync.load(std::memory_order_relaxed)) {
+        // 预缺页页数由辅助线程在真正执行后累计
+        PrefaultWorker::GetInstance()->Submit(span->_shardId, span->_pageId, span->_n);
+        return;
+    }
+    if (PopulateWrite(span->_pageId, span->_n)) {
+        _populatedPages.fetch_add(span->_n, std::memory_order_relaxed);
+    }
+}
+
+void PageHeap::PopulateIfInUse(size_t shard, PAGE_ID id, size_t n) {
+    assert(shard < _shardCount);
+    if (GetShard(shard).PopulateIfInUse(id, n)) {
+        _populatedPages.fetch_add(n, std::memory_order_relaxed);
+    }
+}
+
 void PageHeap::ReleaseSpan(Span* span) {
     if (!span) return;
 
@@ -126,17 +322,350 @@ void PageHeap::ReleaseSpan(Span* span) {
     // 简单的越界检查 (理论上不可能触发)
     assert(idx < _shardCount); 
     
-    _shards[idx].ReleaseSpan(span);
+    // Span 来自该分片，所以分片必然已经构造过
+    // 归还给别的分片时不阻塞在对方的锁上 (对方线程可能正在分配)，
+    // 而是压入对方的无锁归还队列，由持锁者批量处理
+    if (idx != GetShardIndex()) {
+        _deferredReturns.fetch_add(1, std::memory_order_relaxed);
+        GetShard(idx).DeferReleaseSpan(span);
+        return;
+    }
+    GetShard(idx).ReleaseSpan(span);
+}
+
+ReleaseStats PageHeap::GetReleaseStats() {
+    ReleaseStats total;
+    for (size_t i = 0; i < _shardCount; ++i) {
+        // 没构造过的分片没有任何数据，也不需要为了统计去构造它
+        if (!_shardReady[i].load(std::memory_order_acquire)) continue;
+        ReleaseStats one;
+        _shards[i].GetReleaseStats(one);
+        total.AccumulateShard(one);
+    }
+    total.stolenSpans = _stolenSpans.load(std::memory_order_relaxed);
+    total.stolenPages = _stolenPages.load(std::memory_order_relaxed);
+    total.deferredReturns = _deferredReturns.load(std::memory_order_relaxed);
+    total.populatedPages = _populatedPages.load(std::memory_order_relaxed);
+    return total;
+}
+
+ReleaseStats PageHeap::SnapshotReleaseStats() const {
+    ReleaseStats total;
+    for (size_t i = 0; i < _shardCount; ++i) {
+        if (!_shardReady[i].load(std::memory_order_acquire)) continue;
+        ReleaseStats one = _shards[i].SnapshotStats();
+        total.AccumulateShard(one);
+    }
+    total.stolenSpans = _stolenSpans.load(std::memory_order_relaxed);
+    total.stolenPages = _stolenPages.load(std::memory_order_relaxed);
+    total.deferredReturns = _deferredReturns.load(std::memory_order_relaxed);
+    total.populatedPages = _populatedPages.load(std::memory_order_relaxed);
+    return total;
+}
+
+void PageHeap::SetUnderPressure(bool pressure) {
+    _underPressure.store(pressure, std::memory_order_release);
+    for (size_t i = 0; i < _shardCount; ++i) {
+        if (!_shardReady[i].load(std::memory_order_acquire)) continue;
+        _shards[i].SetUnderPressure(pressure);
+    }
+}
+
+void PageHeap::SetQuickLists(bool enabled) {
+    _quickLists.store(enabled, std::memory_order_release);
+    for (size_t i = 0; i < _shardCount; ++i) {
+        if (!_shardReady[i].load(std::memory_order_acquire)) continue;
+        _shards[i].SetQuickLists(enabled);
+    }
+}
+
+void PageHeap::ReleaseFreeMemory() {
+    for (size_t i = 0; i < _shardCount; ++i) {
+        if (!_shardReady[i].load(std::memory_order_acquire)) continue;
+        _shards[i].ReleaseAllFreeMemory();
+    }
+}
+
+Span* PageHeap::StealSpan(size_t thief, size_t k) {
+    // 小对象一次偷一个 1MB 批发块的量，摊薄偷取次数；大对象只偷所需的页数
+    size_t want = std::max(k, NPAGES - 1);
+
+    for (size_t i = 1; i < _shardCount; ++i) {
+        size_t idx = (thief + i) & _shardMask;
+        // 没构造过的分片不可能有空闲页
+        if (!_shardReady[idx].load(std::memory_order_acquire)) continue;
+
+        Span* span = _shards[idx].DonateSpan(k, want, static_cast<uint16_t>(thief));
+        if (span) {
+            _stolenSpans.fetch_add(1, std::memory_order_relaxed);
+            _stolenPages.fetch_add(span->_n, std::memory_order_relaxed);
+            return span;
+        }
+    }
+    return nullptr;
 }
 
 // =========================================================================
 // PageCacheShard 实现 (核心逻辑)
 // =========================================================================
 
+void PageCacheShard::GetReleaseStats(ReleaseStats& stats) {
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        DrainReturnQueueLocked(); // 让统计反映已归还的 Span
+        FillStatsLocked(stats);
+        _published.Write(stats);
+    }
+    DrainReturnQueueAfterUnlock();
+}
+
+void PageCacheShard::FillStatsLocked(ReleaseStats& stats) const {
+    stats.releasedPages = _releasedPagesTotal;
+    stats.releaseEvents = _releaseEventsTotal;
+    stats.refaultedPages = _refaultedPagesTotal;
+    stats.releaseThreshold = _releaseThreshold;
+    stats.freePages = _totalFreePages + _quickPages;
+    stats.quickFlushes = _quickFlushesTotal;
+    stats.madviseCalls = _madviseCallsTotal;
+    stats.usedPages = _usedPages;
+    stats.lockContended = _lockContended.load(std::memory_order_relaxed);
+    stats.lockAcquires = _lockAcquires;
+    stats.lockHoldCycles = _lockHoldCycles;
+}
+
+void PageCacheShard::ReleaseAllFreeMemory() {
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        DrainReturnQueueLocked();
+
+        // 临时把阈值降到 0，复用常规的回收流程
+        size_t saved = _releaseThreshold;
+        _releaseThreshold = 0;
+        ReleaseSomeSpansToSystem();
+        _releaseThreshold = saved;
+        PublishStatsLocked();
+    }
+    DrainReturnQueueAfterUnlock();
+}
+
+void PageCacheShard::SetUnderPressure(bool pressure) {
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        if (_underPressure != pressure) {
+            _underPressure = pressure;
+
+            if (pressure) {
+                _releaseThreshold = MIN_RELEASE_THRESHOLD_PAGES;
+                if (_totalFreePages > _releaseThreshold) {
+                    ReleaseSomeSpansToSystem();
+                }
+            } else {
+                // 固定阈值直接恢复；自适应阈值从下限开始，随需求立即放大
+                _releaseThreshold = _adaptiveRelease ? MIN_RELEASE_THRESHOLD_PAGES : _releaseThresholdCap;
+            }
+            PublishStatsLocked();
+        }
+    }
+    DrainReturnQueueAfterUnlock();
+}
+
+void PageCacheShard::SetQuickLists(bool enabled) {
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        _quickListsEnabled = enabled;
+        if (!enabled && _quickPages > 0) {
+            FlushQuickListsLocked();
+        }
+        PublishStatsLocked();
+    }
+    DrainReturnQueueAfterUnlock();
+}
+
+Span* PageCacheShard::DonateSpan(size_t k, size_t want, uint16_t thief) {
+    std::unique_lock<std::mutex> lock(_mtx, std::try_to_lock);
+    if (!lock.owns_lock()) return nullptr;
+    DrainReturnQueueLocked();
+
+    Span* span = TakeFreeSpanLocked(k);
+    if (span == nullptr) {
+        lock.unlock();
+        DrainReturnQueueAfterUnlock();
+        return nullptr;
+    }
+
+    // 太大的 Span 只交出前 want 页，剩下的留在本分片
+    if (span->_n > want) {
+        Span* rest = _spanPool.New();
+        rest->_pageId = span->_pageId + want;
+        rest->_n = span->_n - want;
+        rest->_releasedPages = span->_releasedPages ? PageMap::GetInstance()->CountReleased(rest->_pageId, rest->_n) : 0;
+        rest->_shardId = _shardId;
+        span->_n = want;
+        span->_releasedPages -= rest->_releasedPages;
+        InsertFreeSpanLocked(rest);
+        // 交出部分的尾页原本是大 Span 的内部页，映射可能是陈旧的，
+        // rest 向左合并时会查到它，必须在解锁前修正
+        PageMap::GetInstance()->set(span->_pageId + span->_n - 1, span);
+    }
+
+    // 解锁前改掉归属：本分片合并时看到 _shardId 不同就不会再碰它
+    span->_shardId = thief;
+    PublishStatsLocked();
+    lock.unlock();
+    DrainReturnQueueAfterUnlock();
+    return span;
+}
+
+bool PageCacheShard::PopulateIfInUse(PAGE_ID id, size_t n) {
+    bool populated = false;
+    {
+        // 持锁期间 Span 不会被归还 (跨分片归还只会压进队列，等持锁者处理)，
+        // 代价是预缺页的这段时间本分片的分配要等待；只有超过阈值的大 Span 才会走到这里
+        std::lock_guard<std::mutex> lock(_mtx);
+        Span* span = PageMap::GetInstance()->get(id);
+        if (span && span->_isUse && span->_shardId == _shardId &&
+            span->_pageId == id && span->_n == n) {
+            populated = PopulateWrite(id, n);
+        }
+    }
+    DrainReturnQueueAfterUnlock();
+    return populated;
+}
+
+Span* PageCacheShard::TakeFreeSpanLocked(size_t k) {
+    auto takeFromMap = [k](LargeSpanMap& map) -> Span* {
+        auto it = map.lower_bound(k);
+        while (it != map.end()) {
+            Span* span = it->second.PopFront();
+            if (span) return span;
+            it = map.erase(it); // 清理空的 Map 节点
+        }
+        return nullptr;
+    };
+
+    // 1. Hot
+    if (k < NPAGES) {
+        for (size_t i = k; i < NPAGES; ++i) {
+            if (!_spanLists[i].Empty()) {
+                Span* span = _spanLists[i].PopFront();
+                _totalFreePages -= span->_n - span->_releasedPages;
+                return span;
+            }
+        }
+    }
+    if (Span* span = takeFromMap(_largeSpanLists)) {
+        _totalFreePages -= span->_n - span->_releasedPages;
+        return span;
+    }
+
+    // 2. Cold (不占 _totalFreePages)
+    if (k < NPAGES) {
+        for (size_t i = k; i < NPAGES; ++i) {
+            if (!_releasedSpanLists[i].Empty()) {
+                return _releasedSpanLists[i].PopFront();
+            }
+        }
+    }
+    return takeFromMap(_releasedLargeSpanLists);
+}
+
+void PageCacheShard::InsertFreeSpanLocked(Span* span) {
+    span->_isUse = false;
+    // 全部页都已归还才算 Cold，混合的 Span 按 Hot 处理
+    span->_isCold = (span->_releasedPages == span->_n);
+
+    // 闲置 Span 只映射首尾，节省 Radix Tree 压力
+    PageMap::GetInstance()->set(span->_pageId, span);
+    PageMap::GetInstance()->set(span->_pageId + span->_n - 1, span);
+
+    if (span->_isCold) {
+        if (span->_n < NPAGES) {
+            _releasedSpanLists[span->_n].PushFront(span);
+        } else {
+            _releasedLargeSpanLists[span->_n].PushFront(span);
+        }
+    } else {
+        if (span->_n < NPAGES) {
+            _spanLists[span->_n].PushFront(span);
+        } else {
+            _largeSpanLists[span->_n].PushFront(span);
+        }
+    }
+    _totalFreePages += span->_n - span->_releasedPages; // 只统计驻留页
+}
+
+void PageCacheShard::RecordDemand() {
+    uint64_t epoch = NowMilliseconds() / DEMAND_SLOT_MS;
+    if (epoch != _demandEpoch) {
+        // 时间前进了若干个槽，把跳过的槽清零 (最多清空整个窗口)
+        uint64_t steps = epoch - _demandEpoch;
+        if (steps > DEMAND_WINDOW_SLOTS) steps = DEMAND_WINDOW_SLOTS;
+        for (uint64_t i = 1; i <= steps; ++i) {
+            size_t slot = (_demandEpoch + i) % DEMAND_WINDOW_SLOTS;
+            _peakUsed[slot] = 0;
+            _refaulted[slot] = 0;
+        }
+        _demandEpoch = epoch;
+    }
+
+    size_t slot = epoch % DEMAND_WINDOW_SLOTS;
+    if (_usedPages > _peakUsed[slot]) {
+        _peakUsed[slot] = _usedPages;
+    }
+}
+
+void PageCacheShard::AdaptReleaseThreshold() {
+    if (!_adaptiveRelease || _underPressure) return;
+
+    size_t peak = 0;
+    size_t refault = 0;
+    for (size_t i = 0; i < DEMAND_WINDOW_SLOTS; ++i) {
+        if (_peakUsed[i] > peak) peak = _peakUsed[i];
+        refault += _refaulted[i];
+    }
+
+    // 期望缓存量 = 近期峰值需求 - 当前需求 (随时可能被再次申请的部分)
+    //            + 近期从 Cold 回填的页数 (说明之前放得太狠，需要多留一些)
+    size_t target = (peak > _usedPages ? peak - _usedPages : 0) + refault;
+    if (target < MIN_RELEASE_THRESHOLD_PAGES) target = MIN_RELEASE_THRESHOLD_PAGES;
+    if (target > _releaseThresholdCap) target = _releaseThresholdCap;
+
+    // 放大：立即生效，需求上涨时不能等
+    if (target >= _releaseThreshold) {
+        _releaseThreshold = target;
+        return;
+    }
+
+    // 缩小：带滞回
+    // 1. 目标值低于当前阈值的 3/4 才收缩，避免在边界附近来回抖动
+    // 2. 每个时间槽最多收缩一次，且每次最多减半
+    if (target < _releaseThreshold - (_releaseThreshold >> 2) && _demandEpoch != _lastShrinkEpoch) {
+        _releaseThreshold = std::max(target, _releaseThreshold >> 1);
+        _lastShrinkEpoch = _demandEpoch;
+    }
+}
+
+Span* PageCacheShard::NewSpan(size_t k, size_t* faults) {
+    auto lock = LockCounted();
+    // 先处理别的线程归还过来的 Span，它们可能正好能满足这次申请
+    DrainReturnQueueLocked();
+
+    // 先推进时间槽：切分时的回填页数记在当前槽里，
+    // 如果之后才推进，空闲一段时间后的第一批回填会被当作过期槽清掉
+    RecordDemand();
+    _lastCarveFaults = 0;
+    Span* span = AllocSpanLocked(k);
 
-Span* PageCacheShard::NewSpan(size_t k) {
-    std::lock_guard<std::mutex> lock(_mtx);
+    _usedPages += span->_n;
+    RecordDemand(); // 记录新的峰值
+    PublishStatsLocked();
+    if (faults) *faults = _lastCarveFaults;
+    UnlockCounted(lock);
+    DrainReturnQueueAfterUnlock();
+    return span;
+}
 
+Span* PageCacheShard::AllocSpanLocked(size_t k) {
     // int safety_ctr = 0; // 安全计数器
     while (true) {
         /*
@@ -150,6 +679,13 @@ Span* PageCacheShard::NewSpan(size_t k) {
         printed = true;
     }
         */
+    // --------------------------------------------------------
+    // Phase 0: 快速链表 (延迟合并的小 Span，只做精确匹配)
+    // --------------------------------------------------------
+    if (k <= QUICK_LIST_MAX_PAGES && !_quickLists[k].Empty()) {
+        return AllocFromQuickList(k);
+    }
+
     // --------------------------------------------------------
     // Phase 1: 尝试从 Hot Cache (热数据) 获取
     // --------------------------------------------------------
@@ -216,8 +752,27 @@ Span* PageCacheShard::NewSpan(size_t k) {
     }
     
 
+    // 本地容器都没货：先把延迟的小 Span 合并起来，可能就拼出了够大的块
+    if (_quickPages > 0) {
+        FlushQuickListsLocked();
+        continue;
+    }
+
+    // --------------------------------------------------------
+    // Phase 3: 从兄弟分片偷取
     // --------------------------------------------------------
-    // Phase 3: SystemAlloc (兜底)
+    // 分片按线程 ID 哈希路由，线程分布不均时，别的分片可能囤着大量空闲页，
+    // 而本分片却要向 OS 申请新内存，进程 RSS 因此虚高
+    // 偷来的 Span 挂进本分片的容器后重试即可 (之后它就归本分片管理)
+    // 注意：偷来的 Span 对象来自对方的 _spanPool，合并时会被归还到本分片的池中，
+    // ObjectPool 的块在进程结束前不会释放，所以跨池归还是安全的
+    if (Span* stolen = PageHeap::GetInstance()->StealSpan(_shardId, k)) {
+        InsertFreeSpanLocked(stolen);
+        continue;
+    }
+
+    // --------------------------------------------------------
+    // Phase 4: SystemAlloc (兜底)
     // --------------------------------------------------------
     
     // ... Phase 3: SystemAlloc ...
@@ -235,6 +790,8 @@ Span* PageCacheShard::NewSpan(size_t k) {
         span->_shardId = _shardId;
         
         for(size_t i = 0; i < k; ++i) PageMap::GetInstance()->set(span->_pageId + i, span);
+        // 新映射的地址段可能曾属于已 munmap 的内存，清掉残留的驻留位
+        PageMap::GetInstance()->SetReleased(span->_pageId, k, false);
         return span;
     } 
     
@@ -249,6 +806,7 @@ Span* PageCacheShard::NewSpan(size_t k) {
     
     PageMap::GetInstance()->set(bigSpan->_pageId, bigSpan);
     PageMap::GetInstance()->set(bigSpan->_pageId + bigSpan->_n - 1, bigSpan);
+    PageMap::GetInstance()->SetReleased(bigSpan->_pageId, bigSpan->_n, false);
     // for(size_t i = 0; i < bigSpan->_n; ++i) PageMap::GetInstance()->set(bigSpan->_pageId + i, bigSpan);
     _spanLists[bigSpan->_n].PushFront(bigSpan);
     _totalFreePages += bigSpan->_n; // 入库，增加热计数
@@ -258,8 +816,104 @@ Span* PageCacheShard::NewSpan(size_t k) {
 }
 
 void PageCacheShard::ReleaseSpan(Span* span) {
-    std::lock_guard<std::mutex> lock(_mtx);
+    auto lock = LockCounted();
+    ReleaseSpanLocked(span);
+    // 放在最后：尽量收走持锁期间别的线程压进来的 Span
+    DrainReturnQueueLocked();
+    PublishStatsLocked();
+    UnlockCounted(lock);
+    // 最后一次清空之后才压栈、又没拿到锁的 Span 在这里收走
+    DrainReturnQueueAfterUnlock();
+}
+
+void PageCacheShard::DeferReleaseSpan(Span* span) {
+    // 1. 无锁压栈
+    Span* head = _returnQueue.load(std::memory_order_relaxed);
+    do {
+        span->_next = head;
+    } while (!_returnQueue.compare_exchange_weak(head, span,
+                                                 std::memory_order_release,
+                                                 std::memory_order_relaxed));
+
+    // 2. 锁空闲时顺手处理，否则留给持锁者：
+    // 持锁者可能在我们压栈之前就清空过队列，但它解锁后会再检查一次 (DrainReturnQueueAfterUnlock)
+    DrainReturnQueueAfterUnlock();
+}
+
+void PageCacheShard::DrainReturnQueueAfterUnlock() {
+    // 压栈者是 "写队列 -> try_lock"，持锁者是 "解锁 -> 读队列"：
+    // 两边各有一个全屏障，至少有一方能看到对方的写入，队列不会无人处理
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    while (_returnQueue.load(std::memory_order_relaxed) != nullptr) {
+        std::unique_lock<std::mutex> lock(_mtx, std::try_to_lock);
+        // 拿不到锁：新的持锁者解锁后会做同样的检查
+        if (!lock.owns_lock()) return;
+        DrainReturnQueueLocked();
+        PublishStatsLocked();
+        lock.unlock();
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+}
+
+void PageCacheShard::DrainReturnQueueSlow() {
+    Span* span = _returnQueue.exchange(nullptr, std::memory_order_acquire);
+    while (span) {
+        Span* next = static_cast<Span*>(span->_next);
+        span->_next = nullptr;
+        ReleaseSpanLocked(span);
+        span = next;
+    }
+}
+
+void PageCacheShard::ReleaseSpanLocked(Span* span) {
+    _usedPages -= span->_n;
+    RecordDemand();
+
+    // 小 Span 延迟合并：先挂进快速链表，马上被同样大小的申请拿走时就省掉了合并 + 切分
+    if (span->_n <= QUICK_LIST_MAX_PAGES && _quickListsEnabled) {
+        span->_isUse = false;
+        span->_isCold = false;
+        span->_isDeferred = true;
+        _quickLists[span->_n].PushFront(span);
+        _quickPages += span->_n;
+
+        // 快速链表囤积过多时批量合并，防止碎片长期无法拼回大块
+        if (_quickPages <= QUICK_LIST_CAP_PAGES) return;
+        FlushQuickListsLocked();
+    } else {
+        CoalesceSpanLocked(span);
+    }
+
+    // ============================================================
+    // 触发回收
+    // ============================================================
+    AdaptReleaseThreshold();
+    if (_totalFreePages > _releaseThreshold) {
+        ReleaseSomeSpansToSystem();
+    }
+}
+
+void PageCacheShard::FlushQuickListsLocked() {
+    for (size_t i = 1; i <= QUICK_LIST_MAX_PAGES; ++i) {
+        while (Span* span = _quickLists[i].PopFront()) {
+            span->_isDeferred = false;
+            CoalesceSpanLocked(span);
+        }
+    }
+    _quickPages = 0;
+    _quickFlushesTotal++;
+}
+
+Span* PageCacheShard::AllocFromQuickList(size_t k) {
+    Span* span = _quickLists[k].PopFront();
+    _quickPages -= k;
+    span->_isDeferred = false;
+    span->_isUse = true;
+    // 延迟期间 Span 的全部页映射都没动过 (只有合并才会改写)，无需重新建立
+    return span;
+}
 
+void PageCacheShard::CoalesceSpanLocked(Span* span) {
     // ============================================================
     // 合并逻辑 (Coalescing)
     // 注意：我们需要处理 Hot 和 Cold 的混合合并
@@ -274,16 +928,15 @@ void PageCacheShard::ReleaseSpan(Span* span) {
         
         // 核心修复：禁止跨分片合并！
         // 必须检查 leftSpan->_shardId == _shardId
-        if (leftSpan == nullptr || leftSpan->_isUse || leftSpan->_shardId != _shardId) break;
+        // 延迟合并中的 Span 挂在快速链表上，留给 FlushQuickListsLocked 处理
+        if (leftSpan == nullptr || leftSpan->_isUse || leftSpan->_isDeferred || leftSpan->_shardId != _shardId) break;
 
         // 摘除邻居 (无论它在 Hot 还是 Cold 容器中)
         leftSpan->Remove();
         
-        // 只有 Hot 的邻居才占用 _totalFreePages
-        // 如果邻居是 Cold 的，它没贡献物理内存计数，所以不能减
-        if (!leftSpan->_isCold) {
-            _totalFreePages -= leftSpan->_n;
-        }
+        // 邻居只有驻留的页计入了 _totalFreePages，已归还的部分并入 span 的计数
+        _totalFreePages -= leftSpan->_n - leftSpan->_releasedPages;
+        span->_releasedPages += leftSpan->_releasedPages;
         
         span->_pageId = leftSpan->_pageId;
         span->_n += leftSpan->_n;
@@ -296,13 +949,12 @@ void PageCacheShard::ReleaseSpan(Span* span) {
         Span* rightSpan = PageMap::GetInstance()->get(rightId);
 
         // 核心修复：禁止跨分片合并！
-        if (rightSpan == nullptr || rightSpan->_isUse || rightSpan->_shardId != _shardId) break;
+        if (rightSpan == nullptr || rightSpan->_isUse || rightSpan->_isDeferred || rightSpan->_shardId != _shardId) break;
 
         rightSpan->Remove();
         
-        if (!rightSpan->_isCold) {
-            _totalFreePages -= rightSpan->_n;
-        }
+        _totalFreePages -= rightSpan->_n - rightSpan->_releasedPages;
+        span->_releasedPages += rightSpan->_releasedPages;
         
         span->_n += rightSpan->_n;
         _spanPool.Delete(rightSpan);
@@ -311,37 +963,23 @@ void PageCacheShard::ReleaseSpan(Span* span) {
     // ============================================================
     // 归还逻辑
     // ============================================================
-    
-    span->_isUse = false;
-    
-    // 【关键决策】合并后的 Span 算 Hot 还是 Cold？
-    // 策略：只要发生合并，或者归还，我们暂时都视为 "Hot"。
-    // 理由：虽然它可能包含 Cold 的部分，但我们把它拉回了活动链表。
-    // 如果它很大且长时间不用，触发 ReleaseSomeSpansToSystem 时会再次将其变 Cold。
-    span->_isCold = false; 
-    
-    // 闲置 Span 只映射首尾，节省 Radix Tree 压力
-    // for(size_t i = 0; i < span->_n; ++i) PageMap::GetInstance()->set(span->_pageId + i, span);
-    PageMap::GetInstance()->set(span->_pageId, span);
-    PageMap::GetInstance()->set(span->_pageId + span->_n - 1, span);
+    // 合并后的 Span 可能同时包含驻留页和已归还的页 (驻留位图记录了每一页的状态)
+    // 只要还有驻留页就挂 Hot 容器，且只把驻留页计入 _totalFreePages；
+    // 之后变冷时也只会 madvise 驻留的那部分
+    InsertFreeSpanLocked(span);
+}
 
-    if (span->_n < NPAGES) {
-        _spanLists[span->_n].PushFront(span);
-    } else {
-        _largeSpanLists[span->_n].PushFront(span);
-    }
-    
-    _totalFreePages += span->_n; // 视为 Hot，增加计数
+void PageCacheShard::ReleaseSomeSpansToSystem() {
+    _releaseEventsTotal++;
 
-    // ============================================================
-    // 触发回收
-    // ============================================================
-    if (_totalFreePages > _releaseThreshold) {
-        ReleaseSomeSpansToSystem();
+    // 本轮要归还的页段先攒在这里，最后合并提交 (仍在锁内，交出 Span 前物理页一定已归还)
+    MadviseBatch batch;
+
+    // 0. 回收前先清扫快速链表，合并后的大块优先变冷
+    if (_quickPages > 0) {
+        FlushQuickListsLocked();
     }
-}
 
-void PageCacheShard::ReleaseSomeSpansToSystem() {
     // 1. 优先回收大对象 (Hot Map -> Cold Map)
     while (_totalFreePages > _releaseThreshold && !_largeSpanLists.empty()) {
         // 取出最大的 SpanList
@@ -363,7 +1001,7 @@ void PageCacheShard::ReleaseSomeSpansToSystem() {
             continue; 
         }
 
-        ReleaseSpanToCold(span);
+        ReleaseSpanToCold(span, batch);
     }
 
     // 2. 其次回收小对象 (Hot Array -> Cold Array)
@@ -373,7 +1011,7 @@ void PageCacheShard::ReleaseSomeSpansToSystem() {
             
             while (_totalFreePages > _releaseThreshold && !list.Empty()) {
                 Span* span = list.PopFront();
-                ReleaseSpanToCold(span);
+                ReleaseSpanToCold(span, batch);
             }
             
             // 如果水位已经降下来了，提前退出循环，不再清理更小的桶
@@ -381,21 +1019,31 @@ void PageCacheShard::ReleaseSomeSpansToSystem() {
             if (_totalFreePages <= _releaseThreshold) break;
         }
     }
+
+    batch.Flush();
+    _madviseCallsTotal += batch.Syscalls();
 }
 
-void PageCacheShard::ReleaseSpanToCold(Span* span) {
-    // 1. 状态变更
-    _totalFreePages -= span->_n; // 从 Hot 计数扣除
-    span->_isCold = true;        // 标记为冷
+void PageCacheShard::ReleaseSpanToCold(Span* span, MadviseBatch& batch) {
+    PageMap* pm = PageMap::GetInstance();
 
-    // 2. Madvise 释放物理内存
-    void* ptr = (void*)(span->_pageId << PAGE_SHIFT);
-#ifdef _WIN32
-    VirtualFree(ptr, span->_n << PAGE_SHIFT, MEM_DECOMMIT);
-#else
-    madvise(ptr, span->_n << PAGE_SHIFT, MADV_DONTNEED);
-    // printf("[DEBUG] Releasing Cold Span: ptr=%p, pages=%zu. Using madvise.\n", ptr, span->_n);
-#endif
+    // 1. 只归还仍然驻留的页段，已经归还过的页不再重复 madvise
+    size_t resident = span->_n - span->_releasedPages;
+    if (resident > 0) {
+        if (span->_releasedPages == 0) {
+            batch.Add(span->_pageId, span->_n);
+        } else {
+            pm->ForEachResidentRun(span->_pageId, span->_n,
+                                   [&batch](PAGE_ID id, size_t n) { batch.Add(id, n); });
+        }
+        pm->SetReleased(span->_pageId, span->_n, true);
+    }
+
+    // 2. 状态变更
+    _totalFreePages -= resident; // 从 Hot 计数扣除
+    _releasedPagesTotal += resident;
+    span->_releasedPages = span->_n;
+    span->_isCold = true;        // 标记为冷
 
     // 3. 挂入 Cold 容器
     if (span->_n < NPAGES) {
@@ -408,73 +1056,58 @@ void PageCacheShard::ReleaseSpanToCold(Span* span) {
     // 这样邻居在合并时，依然可以通过 PageMap 找到这个 Cold Span
 }
 
-Span* PageCacheShard::AllocFromHotList(SpanList& list, size_t k) {
-    Span* span = list.PopFront();
-    
-    // 出库
-    _totalFreePages -= span->_n;
+Span* PageCacheShard::CarveSpanLocked(Span* span, size_t k) {
+    PageMap* pm = PageMap::GetInstance();
 
-    // 切分逻辑
+    // 出库：只有驻留页计入了 _totalFreePages
+    _totalFreePages -= span->_n - span->_releasedPages;
+
+    // 交出去的前 k 页中有多少页已经归还给 OS，就会发生多少次缺页
+    size_t faults = 0;
+    if (span->_releasedPages > 0) {
+        faults = (span->_releasedPages == span->_n) ? k : pm->CountReleased(span->_pageId, k);
+    }
+
+    // 切分逻辑：剩下的部分带着自己的驻留状态挂回对应的容器
     if (span->_n > k) {
         Span* split = _spanPool.New();
         split->_pageId = span->_pageId + k;
         split->_n = span->_n - k;
-        split->_isCold = false; // 剩下的也是热的
+        split->_releasedPages = span->_releasedPages - faults;
+        split->_shardId = _shardId;
 
         span->_n = k;
+        InsertFreeSpanLocked(split);
+    }
 
-        // 剩下的挂回 Hot List
-        _spanLists[split->_n].PushFront(split);
-        _totalFreePages += split->_n; // 回库
-
-        // for(size_t i = 0; i < split->_n; ++i) PageMap::GetInstance()->set(split->_pageId + i, split);
-        PageMap::GetInstance()->set(split->_pageId, split);
-        PageMap::GetInstance()->set(split->_pageId + split->_n - 1, split);
+    _lastCarveFaults = faults;
+    if (faults > 0) {
+        _refaultedPagesTotal += faults;
+        _refaulted[_demandEpoch % DEMAND_WINDOW_SLOTS] += faults;
+        // 交出去后用户写入就会重新驻留
+        pm->SetReleased(span->_pageId, k, false);
     }
+    span->_releasedPages = 0;
 
     // 建立映射
-    for (size_t i = 0; i < k; ++i) PageMap::GetInstance()->set(span->_pageId + i, span);
+    for (size_t i = 0; i < k; ++i) pm->set(span->_pageId + i, span);
     
     span->_isUse = true;
     span->_isCold = false;
     return span;
 }
 
-Span* PageCacheShard::AllocFromColdList(SpanList& list, size_t k) {
-    Span* span = list.PopFront();
-    
-    // Cold Span 不占用 _totalFreePages，所以不需要减计数
-    // 但当它被分配出去后，用户写入数据，它会变热。
-    // 这里我们不需要加 _totalFreePages，因为它直接变成了 _isUse=true
-
-    // 切分逻辑
-    if (span->_n > k) {
-        Span* split = _spanPool.New();
-        split->_pageId = span->_pageId + k;
-        split->_n = span->_n - k;
-        split->_isCold = true; // 剩下的依然是冷的
-
-        span->_n = k;
-
-        // 剩下的挂回 Cold List
-        _releasedSpanLists[split->_n].PushFront(split);
-        
-        // Cold 的 Split 也需要维护首尾映射，方便合并
-        // for (size_t i = 0; i < split->_n; ++i) PageMap::GetInstance()->set(split->_pageId + i, split);
-        PageMap::GetInstance()->set(split->_pageId, split);
-        PageMap::GetInstance()->set(split->_pageId + split->_n - 1, split);
-    }
+Span* PageCacheShard::AllocFromHotList(SpanList& list, size_t k) {
+    return CarveSpanLocked(list.PopFront(), k);
+}
 
-    // 建立映射
-    for (size_t i = 0; i < k; ++i) PageMap::GetInstance()->set(span->_pageId + i, span);
-    
-    span->_isUse = true;
-    span->_isCold = false; // 激活：变热
-    return span;
+Span* PageCacheShard::AllocFromColdList(SpanList& list, size_t k) {
+    return CarveSpanLocked(list.PopFront(), k);
 }
 
 template<typename MapType>
 Span* PageCacheShard::AllocFromMap(MapType& map, typename MapType::iterator it, size_t k, bool isCold) {
+    (void)isCold; // 冷热状态由驻留位图决定
     Span* span = it->second.PopFront();
     // 如果链表意外为空，说明这是一个脏数据（Ghost Entry）
     // 我们应该清理它，并返回 nullptr 通知调用者重试
@@ -482,41 +1115,7 @@ Span* PageCacheShard::AllocFromMap(MapType& map, typename MapType::iterator it,
         map.erase(it);
         return nullptr;
     }
-
-    // 如果是从 Hot Map 拿的，需要减计数
-    if (!isCold) {
-        _totalFreePages -= span->_n;
-    }
-
-    if (span->_n > k) {
-        Span* split = _spanPool.New();
-        split->_pageId = span->_pageId + k;
-        split->_n = span->_n - k;
-        split->_isCold = isCold; // 继承来源的冷热属性
-
-        span->_n = k;
-
-        // 剩下的挂回对应的 Map (Hot->Hot, Cold->Cold)
-        // 这里为了简单，我们根据 isCold 标志决定挂哪里
-        // 注意：AllocFromMap 是模板，但挂回逻辑需要具体对象
-        if (isCold) {
-            _releasedLargeSpanLists[split->_n].PushFront(split);
-        } else {
-            _largeSpanLists[split->_n].PushFront(split);
-            _totalFreePages += split->_n;
-        }
-
-        // for (size_t i = 0; i < split->_n; ++i) PageMap::GetInstance()->set(split->_pageId + i, split);
-        PageMap::GetInstance()->set(split->_pageId, split);
-        PageMap::GetInstance()->set(split->_pageId + split->_n - 1, split);
-    }
-
-    for (size_t i = 0; i < k; ++i) PageMap::GetInstance()->set(span->_pageId + i, span);
-    
-    span->_isUse = true;
-    span->_isCold = false;
-    return span;
+    return CarveSpanLocked(span, k);
 }
 
-
-} // namespace KzAlloc
\ No newline at end of file
+} // namespace KzAlloc
@@ -5,7 +5,11 @@
 #include "ObjectPool.h"
 #include "PageMap.h"
 #include "BootstrapAllocator.h"
+#include "SpinLock.h"
+#include "MadviseBatch.h"
+#include "Stats.h"
 #include <map>
+#include <atomic>
 #include <mutex>
 #include <thread>
 #include <vector>
@@ -17,6 +21,51 @@ namespace KzAlloc {
 // 浪费一个位置(实际上内存占用很小)，但是换来了代码可读性和大量的CPU sub指令避免(不用-1来对齐)
 static constexpr size_t NPAGES = 129; 
 
+// 自适应回收阈值的滑动窗口：DEMAND_WINDOW_SLOTS 个槽，每槽 DEMAND_SLOT_MS 毫秒
+static constexpr size_t DEMAND_WINDOW_SLOTS = 8;
+static constexpr uint64_t DEMAND_SLOT_MS = 1000;
+// 自适应阈值的下限 (2MB)，保证至少能缓存两个 1MB 批发块
+static constexpr size_t MIN_RELEASE_THRESHOLD_PAGES = 256;
+
+// 延迟合并：不超过 QUICK_LIST_MAX_PAGES 页的 Span 归还时先不合并，挂入快速链表
+// 快速链表总页数超过 QUICK_LIST_CAP_PAGES (4MB) 时批量合并
+static constexpr size_t QUICK_LIST_MAX_PAGES = 8;
+static constexpr size_t QUICK_LIST_CAP_PAGES = 512;
+
+// 回收统计 (单个分片或全部分片之和)
+struct ReleaseStats {
+    size_t releasedPages = 0;    // 累计 madvise 归还给 OS 的页数
+    size_t releaseEvents = 0;    // 累计触发 ReleaseSomeSpansToSystem 的次数
+    size_t refaultedPages = 0;   // 累计从 Cold 容器重新分配出去的页数 (每页一次缺页)
+    size_t releaseThreshold = 0; // 当前回收阈值 (页)
+    size_t freePages = 0;        // 当前缓存的 Hot 页数 (含快速链表)
+    size_t usedPages = 0;        // 当前分配出去的页数
+    size_t stolenSpans = 0;      // 从兄弟分片偷来的 Span 数 (即省下的 SystemAlloc 次数)
+    size_t stolenPages = 0;      // 从兄弟分片偷来的页数
+    size_t deferredReturns = 0;  // 跨分片归还时走无锁队列 (没有阻塞在分片锁上) 的 Span 数
+    size_t quickFlushes = 0;     // 快速链表批量合并的次数
+    size_t madviseCalls = 0;     // 归还物理内存用掉的系统调用次数 (批量合并后)
+    size_t populatedPages = 0;   // 复用冷 Span 时预缺页 (MADV_POPULATE_WRITE) 的页数
+    size_t lockContended = 0;    // NewSpan/ReleaseSpan 加分片锁时锁已被占用的次数
+    size_t lockAcquires = 0;     // NewSpan/ReleaseSpan 加分片锁的次数
+    size_t lockHoldCycles = 0;   // NewSpan/ReleaseSpan 累计持有分片锁的周期数 (CycleCount)
+
+    // 累加一个分片的统计 (stolen*/deferredReturns/populatedPages 是 PageHeap 级别的计数，不在分片里)
+    void AccumulateShard(const ReleaseStats& one) {
+        releasedPages += one.releasedPages;
+        releaseEvents += one.releaseEvents;
+        refaultedPages += one.refaultedPages;
+        releaseThreshold += one.releaseThreshold;
+        freePages += one.freePages;
+        usedPages += one.usedPages;
+        quickFlushes += one.quickFlushes;
+        madviseCalls += one.madviseCalls;
+        lockContended += one.lockContended;
+        lockAcquires += one.lockAcquires;
+        lockHoldCycles += one.lockHoldCycles;
+    }
+};
+
 // =========================================================================
 // PageCacheShard
 // 每个分片独立管理一部分内存，拥有独立的锁、Span池和大对象表
@@ -29,16 +78,55 @@ public:
     PageCacheShard(const PageCacheShard&) = delete;
     PageCacheShard& operator=(const PageCacheShard&) = delete;
 
-    Span* NewSpan(size_t k);
+    // faults 非空时返回这个 Span 第一次被写满时会发生的缺页数 (复用冷页的部分)
+    Span* NewSpan(size_t k, size_t* faults = nullptr);
     void ReleaseSpan(Span* span);
 
+    // 跨分片归还：把 Span 压入本分片的无锁归还队列 (MPSC)，不碰分片锁
+    // 随后尝试 try_lock，拿到锁就顺手清空队列；拿不到则由当前持锁者在解锁后处理
+    void DeferReleaseSpan(Span* span);
+
+    // 解锁后调用 (不持有 _mtx)：队列非空就 try_lock 再清空一次
+    // 压栈者 try_lock 失败时把 Span 交给持锁者，而持锁者可能在压栈之前就已经清空过队列；
+    // 每个持锁者 (包括经 GetMutex 加锁的) 解锁后都做这次检查，Span 才不会一直滞留到下一次有人来拿锁
+    void DrainReturnQueueAfterUnlock();
+
     // 设置回收阈值接口
-    void SetReleaseThreshold(size_t thresholdPages) {
+    // adaptive = true 时 thresholdPages 作为上限，实际阈值随近期峰值需求浮动
+    // adaptive = false 时阈值固定 (例如通过环境变量强制指定)
+    void SetReleaseThreshold(size_t thresholdPages, bool adaptive = true) {
+        _releaseThresholdCap = thresholdPages;
         _releaseThreshold = thresholdPages;
+        _adaptiveRelease = adaptive;
     }
 
+    // 读取回收统计 (会加锁，只用于监控)
+    void GetReleaseStats(ReleaseStats& stats);
+
+    // 无锁读取最近一次发布的统计快照 (每次持锁操作结束时发布)
+    // 与 GetReleaseStats 的区别：归还队列中还没被处理的 Span 不计入
+    ReleaseStats SnapshotStats() const { return _published.Read(); }
+
+    // 把全部空闲的驻留页归还给 OS (无视阈值)
+    void ReleaseAllFreeMemory();
+
+    // 内存压力模式：回收阈值压到下限并暂停自适应增长；解除时恢复
+    void SetUnderPressure(bool pressure);
+
+    // 打开/关闭小 Span 的延迟合并 (对比测试用)；关闭时把快速链表中的 Span 立即合并
+    void SetQuickLists(bool enabled);
+
+    // 被其他分片偷取：交出一个至少 k 页的空闲 Span (最多 want 页)
+    // 只 try_lock，拿不到锁或没有合适的 Span 返回 nullptr
+    // 交出的 Span 保持原有的冷热状态，不在任何链表中，_shardId 已改为 thief
+    Span* DonateSpan(size_t k, size_t want, uint16_t thief);
+
+    // 异步预缺页：持锁确认 [id, id + n) 仍是本分片一个在用 Span 的页才执行 MADV_POPULATE_WRITE
+    // Span 已被释放时 (可能已经 madvise 并在驻留位图中记为已归还) 丢弃请求，返回 false
+    bool PopulateIfInUse(PAGE_ID id, size_t n);
+
     // 初始化 Shard ID
-    void InitShard(uint8_t id) {
+    void InitShard(uint16_t id) {
         _shardId = id;
     }
     
@@ -48,8 +136,72 @@ private:
     // 将一部分 Hot Span 转化为 Cold Span
     void ReleaseSomeSpansToSystem();
     
-    // 具体的单体回收动作
-    void ReleaseSpanToCold(Span* span);
+    // 具体的单体回收动作：驻留页段记入 batch，由调用方统一提交
+    void ReleaseSpanToCold(Span* span, MadviseBatch& batch);
+
+    // NewSpan 的实际分配逻辑 (需持有 _mtx)
+    Span* AllocSpanLocked(size_t k);
+
+    // ReleaseSpan 的实际归还逻辑：小 Span 延迟合并，其余立即合并，然后触发回收 (需持有 _mtx)
+    void ReleaseSpanLocked(Span* span);
+
+    // 与左右空闲邻居合并，挂入 Hot 容器 (需持有 _mtx)
+    void CoalesceSpanLocked(Span* span);
+
+    // 把快速链表中的 Span 全部合并回常规容器 (需持有 _mtx)
+    void FlushQuickListsLocked();
+
+    // 从快速链表取一个恰好 k 页的 Span (需持有 _mtx，且链表非空)
+    Span* AllocFromQuickList(size_t k);
+
+    // 一次性取走归还队列中的全部 Span 并逐个归还 (需持有 _mtx)
+    void DrainReturnQueueLocked() {
+        if (_returnQueue.load(std::memory_order_relaxed) == nullptr) [[likely]] return;
+        DrainReturnQueueSlow();
+    }
+    void DrainReturnQueueSlow();
+
+    // 先 try_lock，失败才记一次竞争再阻塞加锁；记下加锁时刻，由 UnlockCounted 累计持锁时间
+    std::unique_lock<std::mutex> LockCounted() {
+        std::unique_lock<std::mutex> lock(_mtx, std::try_to_lock);
+        if (!lock.owns_lock()) [[unlikely]] {
+            _lockContended.fetch_add(1, std::memory_order_relaxed);
+            lock.lock();
+        }
+        _lockAcquires++;
+        _lockAcquiredAt = CycleCount();
+        return lock;
+    }
+
+    void UnlockCounted(std::unique_lock<std::mutex>& lock) {
+        _lockHoldCycles += CycleCount() - _lockAcquiredAt;
+        lock.unlock();
+    }
+
+    // 填充统计 / 把统计发布到无锁快照 (需持有 _mtx，持锁者即唯一写者)
+    void FillStatsLocked(ReleaseStats& stats) const;
+    void PublishStatsLocked() {
+        ReleaseStats stats;
+        FillStatsLocked(stats);
+        _published.Write(stats);
+    }
+
+    // 滑动窗口：推进时间槽，记录当前需求 (需持有 _mtx)
+    void RecordDemand();
+
+    // 根据窗口内的峰值需求和回填量调整 _releaseThreshold (需持有 _mtx)
+    void AdaptReleaseThreshold();
+
+    // 在所有空闲容器中找一个至少 k 页的 Span 并摘下 (需持有 _mtx)
+    // Hot 优先于 Cold，找不到返回 nullptr
+    Span* TakeFreeSpanLocked(size_t k);
+
+    // 把一个空闲 Span 挂入对应的 Hot/Cold 容器并建立首尾映射 (需持有 _mtx)
+    void InsertFreeSpanLocked(Span* span);
+
+    // 从空闲 Span 切出前 k 页交给调用方，剩余部分挂回容器 (需持有 _mtx)
+    // 按驻留位图精确统计这 k 页会引起的缺页数，并把它们标记为驻留
+    Span* CarveSpanLocked(Span* span, size_t k);
 
     // 辅助函数：从指定的热/冷容器中切分 Span
     Span* AllocFromHotList(SpanList& list, size_t k);
@@ -75,6 +227,12 @@ private:
     SpanList _spanLists[NPAGES];        // 1~128 页
     LargeSpanMap _largeSpanLists;       // >128 页
 
+    // 延迟合并的小 Span (_isDeferred = true)，按页数精确分桶
+    SpanList _quickLists[QUICK_LIST_MAX_PAGES + 1];
+    size_t _quickPages = 0;
+    size_t _quickFlushesTotal = 0;
+    bool _quickListsEnabled = true;
+
     // ==========================================================
     // Cold Data (物理内存已 madvise，虚拟地址保留)
     // ==========================================================
@@ -92,6 +250,11 @@ private:
     ObjectPool<Span> _spanPool;
     std::mutex _mtx;
 
+    // 跨分片归还队列 (Treiber 栈)：多个生产者 CAS 压入，持锁者 exchange 一次性取走
+    // 队列中的 Span 依然是 _isUse = true，邻居合并时不会碰它们
+    // 借用 Span 的 _next 作为链接 (在用的 Span 不在任何 SpanList 中)
+    std::atomic<Span*> _returnQueue{nullptr};
+
     // 回收阈值控制
     // 记录当前 Shard 缓存了多少页。仅统计 Hot Pages，如果超过阈值，就归还给 OS
     size_t _totalFreePages = 0;
@@ -101,8 +264,35 @@ private:
     // 如果是 32 核 128 分片，这个值应该调小，比如 2048 (16MB)
     size_t _releaseThreshold = 256;
 
+    // ==========================================================
+    // 自适应回收 (Peak-Based Release)
+    // ==========================================================
+    // 思路与 tcmalloc 一致：只归还超出"近期峰值需求"的部分。
+    // 突发型业务在两次突发之间不会把马上又要用的页 madvise 掉再缺页回来
+    size_t _releaseThresholdCap = 256;  // 阈值上限 (由物理内存推算)
+    bool   _adaptiveRelease = true;
+    bool   _underPressure = false;      // 内存压力模式 (由 PressureMonitor 设置)
+    size_t _usedPages = 0;              // 当前分配出去 (_isUse) 的页数
+
+    uint64_t _demandEpoch = 0;                        // 当前时间槽编号
+    size_t _peakUsed[DEMAND_WINDOW_SLOTS] = {0};      // 每个槽内 _usedPages 的峰值
+    size_t _refaulted[DEMAND_WINDOW_SLOTS] = {0};     // 每个槽内从 Cold 回填的页数
+    uint64_t _lastShrinkEpoch = 0;                    // 上次收缩阈值的时间槽 (每槽最多收缩一次)
+
+    // 统计计数 (持锁更新)
+    size_t _releasedPagesTotal = 0;
+    size_t _releaseEventsTotal = 0;
+    size_t _refaultedPagesTotal = 0;
+    size_t _madviseCallsTotal = 0;
+    size_t _lastCarveFaults = 0; // 最近一次 CarveSpanLocked 的缺页数 (NewSpan 取走)
+    SeqlockSnapshot<ReleaseStats> _published; // 无锁统计快照
+    std::atomic<size_t> _lockContended{0};    // 在锁外递增，所以是原子变量
+    size_t _lockAcquires = 0;                 // 以下三项持锁更新 (LockCounted / UnlockCounted)
+    size_t _lockHoldCycles = 0;
+    uint64_t _lockAcquiredAt = 0;
+
     // 记录当前 Shard 的 ID
-    uint8_t _shardId = 0;
+    uint16_t _shardId = 0;
 };
 
 // =========================================================================
@@ -134,6 +324,45 @@ public:
     Span* NewSpan(size_t k);
     void ReleaseSpan(Span* span);
 
+    // 汇总所有已构造分片的回收统计
+    ReleaseStats GetReleaseStats();
+
+    // 同上，但只读各分片发布的快照，不加任何锁 (监控线程高频轮询用)
+    ReleaseStats SnapshotReleaseStats() const;
+
+    // 单个分片的无锁快照；分片尚未构造时返回 false
+    bool SnapshotShardStats(size_t idx, ReleaseStats& stats) const {
+        if (idx >= _shardCount || !_shardReady[idx].load(std::memory_order_acquire)) return false;
+        stats = _shards[idx].SnapshotStats();
+        return true;
+    }
+
+    size_t ShardCount() const { return _shardCount; }
+
+    // 把所有分片中空闲的驻留页归还给 OS (类似 tcmalloc 的 ReleaseFreeMemory)
+    void ReleaseFreeMemory();
+
+    // 把每个 Span 的布局以 JSON Lines 写入 fd (实现见 HeapDump.cpp)
+    // 期间持有全部分片锁，只用于诊断；写入失败返回 false
+    bool DumpHeap(int fd);
+
+    // 内存压力模式：所有已构造分片的回收阈值压到下限
+    void SetUnderPressure(bool pressure);
+
+    // 打开/关闭所有分片的小 Span 延迟合并 (默认打开，对比测试用)
+    void SetQuickLists(bool enabled);
+
+    // 复用不少于 pages 页的冷 Span 时预先缺页 (0 关闭)，async 为 true 时交给辅助线程
+    // 也可以通过环境变量 KZALLOC_POPULATE_THRESHOLD_PAGES / KZALLOC_POPULATE_ASYNC 设置
+    void SetPopulateThreshold(size_t pages, bool async = false);
+
+    // 分片本地没有合适的空闲 Span 时，在向 OS 申请之前先从兄弟分片偷一个
+    // 调用方持有 thief 分片的锁，这里对其他分片只 try_lock，不会死锁
+    Span* StealSpan(size_t thief, size_t k);
+
+    // 异步预缺页的辅助线程调用：到 shard 分片的锁内复核 Span 仍在使用再预缺页
+    void PopulateIfInUse(size_t shard, PAGE_ID id, size_t n);
+
 private:
     // 构造函数中进行自举初始化
     PageHeap();
@@ -144,10 +373,39 @@ private:
     // 高性能路由函数
     size_t GetShardIndex();
 
+    // 获取分片，首次访问时才构造 (Lazy Init)
+    PageCacheShard& GetShard(size_t idx) {
+        if (!_shardReady[idx].load(std::memory_order_acquire)) [[unlikely]] {
+            ConstructShard(idx);
+        }
+        return _shards[idx];
+    }
+
+    // 慢速路径：在预留好的裸内存上原地构造分片
+    void ConstructShard(size_t idx);
+
+    // 对刚分配出去的 Span 做 MADV_POPULATE_WRITE (同步或提交给辅助线程)
+    void PrefaultSpan(Span* span);
+
 private:
-    PageCacheShard* _shards = nullptr; // 动态数组指针 (指向 SystemAlloc 的内存)
+    PageCacheShard* _shards = nullptr; // 动态数组指针 (指向 SystemAlloc 的内存，只预留不构造)
+    std::atomic<bool>* _shardReady = nullptr; // 每个分片是否已构造 (与分片数组同一块内存)
     size_t _shardCount = 0;            // 分片数量 (2的幂)
     size_t _shardMask = 0;             // 路由掩码
+    size_t _shardThreshold = 0;        // 每个分片的回收阈值 (构造时算好，分片构造时注入)
+    bool _adaptiveRelease = true;      // 环境变量强制指定阈值时关闭自适应
+    SpinMutex _initMtx;                // 仅保护分片的首次构造
+
+    std::atomic<size_t> _stolenSpans{0}; // 跨分片偷取成功的次数
+    std::atomic<size_t> _stolenPages{0}; // 跨分片偷取的页数
+    std::atomic<size_t> _deferredReturns{0}; // 走无锁归还队列的 Span 数
+
+    std::atomic<bool> _underPressure{false};   // 内存压力模式 (新构造的分片也要继承)
+    std::atomic<bool> _quickLists{true};       // 小 Span 延迟合并 (新构造的分片也要继承)
+
+    std::atomic<size_t> _populateThreshold{0}; // 预缺页阈值 (页)，0 表示关闭
+    std::atomic<bool> _populateAsync{false};
+    std::atomic<size_t> _populatedPages{0};
 
 };
 
@@ -10,27 +10,31 @@ namespace KzAlloc {
 
 // =========================================================================
 // Radix Tree 配置 (根据平台自动调整层级)
+// SHIFT 是页偏移位数：全局 PageHeap 使用 PageMap = BasicPageMap<PAGE_SHIFT>，
+// BasicAllocator 的独立堆按各自的页大小实例化 (根节点位数随之变化)
 // =========================================================================
-class PageMap {
+template <size_t SHIFT>
+class BasicPageMap {
 private:
     // 64位系统: 3 层基数树
-    // 有效虚拟地址 48位 - 页偏移 13位 = 35位有效 PageID
-    // 划分: Root(12bit) -> Internal(12bit) -> Leaf(11bit)
+    // 有效虚拟地址 48位 - 页偏移 SHIFT 位 = 有效 PageID (8KB 页时 35 位)
+    // 划分: Root(25-SHIFT bit，8KB 页时 12bit) -> Internal(12bit) -> Leaf(11bit)
 #if defined(_WIN64) || defined(__x86_64__) || defined(__aarch64__)
     static constexpr int RADIX_TREE_LEVELS = 3;
-    static constexpr int BITS_ROOT = 12;
     static constexpr int BITS_INTERNAL = 12;
     static constexpr int BITS_LEAF = 11;
+    static constexpr int BITS_ROOT = 48 - (int)SHIFT - BITS_INTERNAL - BITS_LEAF;
 
     // 32位系统: 2 层基数树
-    // 有效虚拟地址 32位 - 页偏移 13位 = 19位有效 PageID
-    // 划分: Root(5bit) -> Leaf(14bit)
+    // 有效虚拟地址 32位 - 页偏移 SHIFT 位 = 有效 PageID (8KB 页时 19 位)
+    // 划分: Root(18-SHIFT bit，8KB 页时 5bit) -> Leaf(14bit)
 #else
     static constexpr int RADIX_TREE_LEVELS = 2;
-    static constexpr int BITS_ROOT = 5;
     static constexpr int BITS_LEAF = 14;
     static constexpr int BITS_INTERNAL = 0;
+    static constexpr int BITS_ROOT = 32 - (int)SHIFT - BITS_LEAF;
 #endif
+    static_assert(BITS_ROOT > 0, "page shift too large for the radix tree");
 
     // 计算各层数组长度
     static constexpr size_t LEN_ROOT = 1 << BITS_ROOT;
@@ -39,8 +43,11 @@ private:
 
 private:
     // Leaf Node: 最底层，直接存储 Span 指针
+    // released 是与 values 平行的驻留位图：第 i 位为 1 表示该页已被 madvise 归还给 OS
+    // 相邻的 Span 可能属于不同分片、共用同一个 64 位字，所以位图用原子读改写
     struct PageMapLeaf {
         Span* values[LEN_LEAF];
+        uint64_t released[LEN_LEAF / 64];
     };
 
     // Internal Node: 中间层，存储 Leaf 指针
@@ -50,12 +57,12 @@ private:
     };
 
 public:
-    static PageMap* GetInstance() {
-    alignas(PageMap) static char _buffer[sizeof(PageMap)];
-    static PageMap* _instance = nullptr;
+    static BasicPageMap* GetInstance() {
+    alignas(BasicPageMap) static char _buffer[sizeof(BasicPageMap)];
+    static BasicPageMap* _instance = nullptr;
     
     static const bool _inited = [&]() {
-        _instance = new (_buffer) PageMap();
+        _instance = new (_buffer) BasicPageMap();
         return true;
     }();
     
@@ -64,6 +71,14 @@ public:
     return _instance;
     }
 
+    // 独立堆 (BasicAllocator) 各自持有一份，不与全局 PageHeap 共用
+    explicit BasicPageMap() {
+        std::memset(_root, 0, sizeof(_root));
+    }
+
+    BasicPageMap(const BasicPageMap&) = delete;
+    BasicPageMap& operator=(const BasicPageMap&) = delete;
+
     // ---------------------------------------------------------------------
     // 查映射 (Read): O(1) 无锁
     // ---------------------------------------------------------------------
@@ -125,13 +140,114 @@ public:
 #endif
     }
 
-private:
-    explicit PageMap() {
-        std::memset(_root, 0, sizeof(_root));
+    // ---------------------------------------------------------------------
+    // 驻留位图 (Residency Bitmap)
+    // 只在持有页面所属分片锁的情况下调用，页面必须已经 set 过 (叶子节点存在)
+    // ---------------------------------------------------------------------
+
+    // 把 [id, id + n) 标记为已归还 (released = true) 或驻留 (released = false)
+    void SetReleased(PAGE_ID id, size_t n, bool released) {
+        while (n > 0) {
+            uint64_t* word = ReleasedWord(id);
+            size_t bit = id & 63;
+            size_t cnt = std::min<size_t>(n, 64 - bit);
+            uint64_t mask = (cnt == 64 ? ~0ULL : ((1ULL << cnt) - 1)) << bit;
+            if (released) {
+                __atomic_fetch_or(word, mask, __ATOMIC_RELAXED);
+            } else {
+                __atomic_fetch_and(word, ~mask, __ATOMIC_RELAXED);
+            }
+            id += cnt;
+            n -= cnt;
+        }
     }
 
-    PageMap(const PageMap&) = delete;
-    PageMap& operator=(const PageMap&) = delete;
+    // 统计 [id, id + n) 中已归还的页数 (即重新使用时会发生的缺页数)
+    size_t CountReleased(PAGE_ID id, size_t n) const {
+        size_t total = 0;
+        while (n > 0) {
+            uint64_t* word = ReleasedWord(id);
+            size_t bit = id & 63;
+            size_t cnt = std::min<size_t>(n, 64 - bit);
+            uint64_t mask = (cnt == 64 ? ~0ULL : ((1ULL << cnt) - 1)) << bit;
+            total += __builtin_popcountll(__atomic_load_n(word, __ATOMIC_RELAXED) & mask);
+            id += cnt;
+            n -= cnt;
+        }
+        return total;
+    }
+
+    // 依次回调 [id, id + n) 中每一段连续驻留的页 fn(start, len)
+    template <class Fn>
+    void ForEachResidentRun(PAGE_ID id, size_t n, Fn&& fn) const {
+        PAGE_ID end = id + n;
+        PAGE_ID runStart = 0;
+        bool inRun = false;
+        for (PAGE_ID cur = id; cur < end; ++cur) {
+            // 整字全为已归还时直接跳过 64 页
+            if ((cur & 63) == 0 && cur + 64 <= end &&
+                __atomic_load_n(ReleasedWord(cur), __ATOMIC_RELAXED) == ~0ULL) {
+                if (inRun) { fn(runStart, cur - runStart); inRun = false; }
+                cur += 63;
+                continue;
+            }
+            bool released = (__atomic_load_n(ReleasedWord(cur), __ATOMIC_RELAXED) >> (cur & 63)) & 1;
+            if (!released && !inRun) { runStart = cur; inRun = true; }
+            if (released && inRun) { fn(runStart, cur - runStart); inRun = false; }
+        }
+        if (inRun) fn(runStart, end - runStart);
+    }
+
+    // ---------------------------------------------------------------------
+    // 遍历 (诊断用)
+    // 按页号升序回调每个 Span 一次 fn(span)
+    // 空闲 Span 只映射首尾页，内部页上可能残留着已被合并掉的旧 Span 指针，
+    // 所以只接受 _pageId 恰好等于当前页的条目，并跳过已输出 Span 覆盖的页
+    // 调用方需要持有全部分片锁，否则遍历期间的切分与合并可能被看到一半
+    // ---------------------------------------------------------------------
+    template <class Fn>
+    void ForEachSpan(Fn&& fn) const {
+        PAGE_ID skipUntil = 0;
+        auto visitLeaf = [&](const PageMapLeaf* leaf, PAGE_ID base) {
+            for (size_t i = 0; i < LEN_LEAF; ++i) {
+                PAGE_ID id = base + i;
+                if (id < skipUntil) continue;
+                Span* span = leaf->values[i];
+                if (span == nullptr || span->_pageId != id || span->_n == 0) continue;
+                fn(span);
+                skipUntil = id + span->_n;
+            }
+        };
+#if defined(_WIN64) || defined(__x86_64__) || defined(__aarch64__)
+        for (size_t r = 0; r < LEN_ROOT; ++r) {
+            if (_root[r] == nullptr) continue;
+            for (size_t m = 0; m < LEN_INTERNAL; ++m) {
+                const PageMapLeaf* leaf = _root[r]->leafs[m];
+                if (leaf == nullptr) continue;
+                visitLeaf(leaf, ((PAGE_ID)r << (BITS_INTERNAL + BITS_LEAF)) | ((PAGE_ID)m << BITS_LEAF));
+            }
+        }
+#else
+        for (size_t r = 0; r < LEN_ROOT; ++r) {
+            if (_root[r] == nullptr) continue;
+            visitLeaf(_root[r], (PAGE_ID)r << BITS_LEAF);
+        }
+#endif
+    }
+
+private:
+    // 定位某页的驻留位所在的字
+    uint64_t* ReleasedWord(PAGE_ID id) const {
+#if defined(_WIN64) || defined(__x86_64__) || defined(__aarch64__)
+        size_t iRoot = id >> (BITS_INTERNAL + BITS_LEAF);
+        size_t iInternal = (id >> BITS_LEAF) & (LEN_INTERNAL - 1);
+        PageMapLeaf* leaf = _root[iRoot]->leafs[iInternal];
+#else
+        PageMapLeaf* leaf = _root[id >> BITS_LEAF];
+#endif
+        assert(leaf);
+        return &leaf->released[(id & (LEN_LEAF - 1)) >> 6];
+    }
 
     // 辅助函数：申请节点内存 (使用 SystemAlloc 绕过 malloc)
     // 自动计算需要申请的页数
@@ -191,4 +307,6 @@ private:
     std::mutex _growMtx; 
 };
 
+using PageMap = BasicPageMap<PAGE_SHIFT>;
+
 } // namespace KzAlloc
\ No newline at end of file
@@ -0,0 +1,137 @@
+#include "PressureMonitor.h"
+#include "PageCache.h"
+#include "CentralCache.h"
+#include "ThreadCache.h"
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#endif
+
+namespace KzAlloc {
+
+bool PressureMonitor::Start(const PressureMonitorOptions& options) {
+    double avg10 = 0;
+    uint64_t total = 0;
+    if (!ReadPressure(options.path, avg10, total)) return false;
+
+    bool expected = false;
+    if (!_running.compare_exchange_strong(expected, true)) return false;
+
+    _options = options;
+    if (_options.intervalMs == 0) _options.intervalMs = 1;
+    _thread = std::thread([this]() { Run(); });
+    return true;
+}
+
+void PressureMonitor::Stop() {
+    if (!_running.exchange(false)) return;
+    if (_thread.joinable()) _thread.join();
+
+    if (_underPressure.exchange(false)) {
+        PageHeap::GetInstance()->SetUnderPressure(false);
+    }
+}
+
+PressureStats PressureMonitor::GetStats() const {
+    PressureStats stats;
+    stats.underPressure = _underPressure.load(std::memory_order_relaxed);
+    stats.lastStallPercent = _lastStallPercent.load(std::memory_order_relaxed);
+    stats.samples = _samples.load(std::memory_order_relaxed);
+    stats.pressureEvents = _pressureEvents.load(std::memory_order_relaxed);
+    stats.purges = _purges.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void PressureMonitor::Run() {
+    uint64_t lastTotal = 0;
+    bool haveLast = false;
+
+    while (_running.load(std::memory_order_acquire)) {
+        // 分段睡眠，Stop 时不必等满一个周期
+        for (uint32_t slept = 0; slept < _options.intervalMs && _running.load(std::memory_order_acquire); ) {
+            uint32_t step = std::min<uint32_t>(_options.intervalMs - slept, 50);
+            std::this_thread::sleep_for(std::chrono::milliseconds(step));
+            slept += step;
+        }
+        if (!_running.load(std::memory_order_acquire)) break;
+
+        double avg10 = 0;
+        uint64_t total = 0;
+        if (ReadPressure(_options.path, avg10, total)) {
+            // 停顿占比优先用 total 的增量 (最近一个周期，反应最快)，
+            // 第一次采样或计数器回绕时退回到内核给出的 10 秒均值
+            double stall = avg10;
+            if (haveLast && total >= lastTotal) {
+                stall = (double)(total - lastTotal) * 100.0 / ((double)_options.intervalMs * 1000.0);
+            }
+            lastTotal = total;
+            haveLast = true;
+
+            _lastStallPercent.store(stall, std::memory_order_relaxed);
+            _samples.fetch_add(1, std::memory_order_relaxed);
+
+            bool pressured = _underPressure.load(std::memory_order_relaxed);
+            if (!pressured && stall >= _options.highStallPercent) {
+                _underPressure.store(true, std::memory_order_relaxed);
+                _pressureEvents.fetch_add(1, std::memory_order_relaxed);
+                PageHeap::GetInstance()->SetUnderPressure(true);
+                Purge();
+            } else if (pressured && stall <= _options.lowStallPercent) {
+                _underPressure.store(false, std::memory_order_relaxed);
+                PageHeap::GetInstance()->SetUnderPressure(false);
+            } else if (pressured) {
+                Purge();
+            }
+        }
+
+        // 所有线程都空闲时没有 Scavenge，由监控线程清扫超时的空 Span，并叫醒各线程按时间回收
+        CentralCache::GetInstance()->SweepEmptySpans();
+        ThreadCache::WakeAllPeriodically();
+    }
+}
+
+void PressureMonitor::Purge() {
+    // 1. 线程缓存：异步，各线程在下一次申请时 (快速路径也会检查) 自行冲刷
+    RequestThreadCacheFlush();
+    // 2. CentralCache 中缓存的空 Span 立即还给 PageHeap
+    CentralCache::GetInstance()->ReleaseEmptySpans(true);
+    // 3. PageHeap 中的空闲驻留页全部归还给 OS
+    PageHeap::GetInstance()->ReleaseFreeMemory();
+    _purges.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool PressureMonitor::ReadPressure(const char* path, double& avg10, uint64_t& totalUs) {
+#ifdef _WIN32
+    (void)path;
+    (void)avg10;
+    (void)totalUs;
+    return false;
+#else
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+
+    // 格式：
+    // some avg10=0.00 avg60=0.00 avg300=0.00 total=0
+    // full avg10=0.00 avg60=0.00 avg300=0.00 total=0
+    char buf[256];
+    ssize_t len = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if (len <= 0) return false;
+    buf[len] = '\0';
+
+    const char* line = std::strstr(buf, "some");
+    if (line == nullptr) return false;
+    const char* a = std::strstr(line, "avg10=");
+    const char* t = std::strstr(line, "total=");
+    if (a == nullptr || t == nullptr) return false;
+
+    avg10 = std::strtod(a + 6, nullptr);
+    totalUs = std::strtoull(t + 6, nullptr, 10);
+    return true;
+#endif
+}
+
+} // namespace KzAlloc
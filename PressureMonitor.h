@@ -0,0 +1,81 @@
+#pragma once
+
+#include "Common.h"
+#include <atomic>
+#include <thread>
+
+namespace KzAlloc {
+
+// =========================================================================
+// PressureMonitor (内存压力监控)
+// 可选的后台线程，周期性读取 PSI (/proc/pressure/memory)，根据停顿时间占比判断内存压力：
+// 1. 进入压力：PageHeap 回收阈值压到下限，通知所有 ThreadCache 冲刷，
+//    CentralCache 的空 Span 缓存和 PageHeap 的空闲页全部归还给 OS
+// 2. 压力持续：每个周期继续清扫，赶在内核回收之前把缓存让出去
+// 3. 压力解除：恢复回收阈值，各级缓存随后按需重新长大
+// 文件路径可配置 (测试时可以换成伪造的 PSI 文件)
+// 环境变量 KZALLOC_PSI_PATH 设置后，PageHeap 初始化时自动启动 (值为 "1" 时使用默认路径)
+// =========================================================================
+
+struct PressureMonitorOptions {
+    const char* path = "/proc/pressure/memory";
+    uint32_t intervalMs = 1000;    // 采样周期
+    double highStallPercent = 10.0; // "some" 停顿占比达到该值进入压力模式
+    double lowStallPercent = 2.0;   // 降到该值以下解除 (滞回，避免来回切换)
+};
+
+struct PressureStats {
+    bool underPressure = false;
+    double lastStallPercent = 0;  // 最近一个周期的停顿占比
+    size_t samples = 0;           // 成功采样次数
+    size_t pressureEvents = 0;    // 进入压力模式的次数
+    size_t purges = 0;            // 执行清扫的次数
+};
+
+class PressureMonitor {
+public:
+    static PressureMonitor* GetInstance() {
+        alignas(PressureMonitor) static char _buffer[sizeof(PressureMonitor)];
+        static PressureMonitor* _instance = nullptr;
+        static const bool _inited = [&]() {
+            _instance = new (_buffer) PressureMonitor();
+            return true;
+        }();
+        (void)_inited;
+        return _instance;
+    }
+
+    // 启动监控线程；已在运行或文件无法读取时返回 false
+    // 注意：options.path 指向的字符串必须在监控期间一直有效
+    bool Start(const PressureMonitorOptions& options = PressureMonitorOptions());
+
+    // 停止监控线程并解除压力模式
+    void Stop();
+
+    PressureStats GetStats() const;
+
+private:
+    PressureMonitor() = default;
+
+    void Run();
+
+    // 读取 PSI 文件中 "some" 一行的 avg10 (百分比) 与 total (微秒)
+    // 只用 open/read 和栈上缓冲区，不分配内存
+    static bool ReadPressure(const char* path, double& avg10, uint64_t& totalUs);
+
+    // 进入压力模式或压力持续时的清扫
+    void Purge();
+
+private:
+    PressureMonitorOptions _options;
+    std::thread _thread;
+    std::atomic<bool> _running{false};
+
+    std::atomic<bool> _underPressure{false};
+    std::atomic<double> _lastStallPercent{0};
+    std::atomic<size_t> _samples{0};
+    std::atomic<size_t> _pressureEvents{0};
+    std::atomic<size_t> _purges{0};
+};
+
+} // namespace KzAlloc
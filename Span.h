@@ -1,6 +1,5 @@
 #pragma once
 #include "Common.h"
-#include "ObjectPool.h"
 
 namespace KzAlloc {
 // 定义链表节点基类 (只包含指针)
@@ -17,13 +16,20 @@ struct Span : public SpanLink {
     
     size_t  _objSize = 0;    // 切分的小对象大小 (CentralCache 使用)
     size_t  _useCount = 0;   // 分配出去的小对象数量
+    size_t  _objCount = 0;   // 切分出的小对象总数 (CentralCache 按占用率分桶时使用)
+    size_t  _releasedPages = 0; // 空闲时其中已 madvise 归还给 OS 的页数 (明细在 PageMap 的驻留位图中)
     void* _freeList = nullptr; // 切好小对象的空闲链表
     
     bool    _isUse = false;  // true: 在 CentralCache/用户手中; false: 在 PageCache 中
-    bool   _isCold = false;   // 标记是否为冷数据 (物理内存已释放，但虚拟地址保留)
+    bool   _isCold = false;   // 标记是否为冷数据 (全部页的物理内存都已释放，但虚拟地址保留)
+    uint8_t _occupancy = 0;   // 在 CentralCache 中所处的占用率等级
+    bool   _isDeferred = false; // 在 PageCacheShard 的快速链表中等待延迟合并 (邻居合并时跳过)
+    bool   _longLived = false;  // 属于 CentralCache 的长寿命 Span 池 (切分时设置)
+    bool   _isolated = false;   // 属于 CentralCache 的隔离 Span 池，按隔离规格切分 (切分时设置)
     
     // 记录该 Span 属于哪个 PageCacheShard，防止跨分片死锁
-    uint8_t _shardId = 0;
+    // 128 核机器上分片数可达 512，uint8_t 会溢出，所以用 uint16_t
+    uint16_t _shardId = 0;
 
     void Remove() {
         _prev->_next = _next;
@@ -34,56 +40,47 @@ struct Span : public SpanLink {
 };
 
 // 双向链表容器 (带哨兵位)
+// 哨兵节点内嵌在容器中，构造时不需要任何内存分配，
+// 大量 SpanList (每个 Shard 258 个) 的构造因此只是几次指针写入
 class SpanList {
 public:
 
     SpanList() {
-        _head = GetSentinelPool().New();
-        _head->_next = reinterpret_cast<Span*>(_head);
-        _head->_prev = reinterpret_cast<Span*>(_head);
+        _head._next = &_head;
+        _head._prev = &_head;
     } 
 
-    ~SpanList() {
-        if (_head) {
-            GetSentinelPool().Delete(_head); // 替代 delete _head
-            _head = nullptr;
-        }
-    }
+    ~SpanList() = default;
     
     // 禁用拷贝
     SpanList(const SpanList&) = delete;
     SpanList& operator=(const SpanList&) = delete;
 
     // B. 允许移动构造 (Move Constructor)
-    // std::map 在旋转平衡树时需要移动节点，这是必须实现的！
-    SpanList(SpanList&& other) noexcept {
-        // 1. 接管对方的哨兵
-        _head = other._head;
-        // 2. 把对方置空，防止对方析构时销毁哨兵
-        other._head = nullptr;
+    // 哨兵内嵌后不能直接交换指针，必须把首尾节点重新挂到自己的哨兵上
+    SpanList(SpanList&& other) noexcept : SpanList() {
+        TakeFrom(other);
     }
 
     // C. 允许移动赋值
     SpanList& operator=(SpanList&& other) noexcept {
         if (this != &other) {
-            // 1. 先释放自己的旧哨兵
-            if (_head) GetSentinelPool().Delete(_head);
-            
-            // 2. 接管对方
-            _head = other._head;
-            other._head = nullptr;
+            // 与旧实现一致：丢弃自己原有的节点 (只断开，不释放)
+            _head._next = &_head;
+            _head._prev = &_head;
+            TakeFrom(other);
         }
         return *this;
     }
 
     Span* Begin() { 
-        return static_cast<Span*>(_head->_next); 
+        return static_cast<Span*>(_head._next); 
     }
     Span* End() { 
-        return static_cast<Span*>(_head); 
+        return static_cast<Span*>(&_head); 
     }
     bool Empty() const { 
-        return _head->_next == _head; 
+        return _head._next == &_head; 
     }
 
     void PushFront(Span* span) {
@@ -131,15 +128,18 @@ public:
     }
 
 private:
-    SpanLink* _head = nullptr; // 哨兵节点
-
-    // 【私有静态单例池】
-    // 专门用于分配 SpanList 的哨兵节点
-    // 使用 static 局部变量保证线程安全的惰性初始化
-    static ObjectPool<SpanLink>& GetSentinelPool() {
-        static ObjectPool<SpanLink> pool;
-        return pool;
+    // 接管 other 的全部节点 (要求自身为空)，other 被重置为空链表
+    void TakeFrom(SpanList& other) {
+        if (other.Empty()) return;
+        _head._next = other._head._next;
+        _head._prev = other._head._prev;
+        _head._next->_prev = &_head;
+        _head._prev->_next = &_head;
+        other._head._next = &other._head;
+        other._head._prev = &other._head;
     }
+
+    SpanLink _head; // 内嵌哨兵节点
 };
 
 }
\ No newline at end of file
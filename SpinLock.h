@@ -52,6 +52,11 @@ public:
         }
     }
 
+    // 只尝试一次，不自旋 (用于统计锁竞争：先 try_lock，失败再 lock)
+    bool try_lock() {
+        return !_flag.test(std::memory_order_relaxed) && !_flag.test_and_set(std::memory_order_acquire);
+    }
+
     void unlock() {
         _flag.clear(std::memory_order_release);
     }
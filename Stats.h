@@ -0,0 +1,211 @@
+#pragma once
+
+#include "Common.h"
+#include "ObjectPool.h"
+#include "SpinLock.h"
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include <type_traits>
+
+namespace KzAlloc {
+
+// =========================================================================
+// SeqlockSnapshot (统计快照)
+// 监控线程读取统计时不能加分片锁/桶锁，否则会出现在分配延迟的长尾里
+// 1. 写者 (同一时刻只有一个，由调用方保证：分片锁、所属线程等)：
+//    序号变奇数 -> 逐字写入 -> 序号变偶数
+// 2. 读者：前后两次读到同一个偶数序号，中间读到的就是一份一致的快照，否则重读
+// 字段逐字存放在原子变量里，读写并发时没有数据竞争；读者从不阻塞写者
+// =========================================================================
+template <typename T>
+class SeqlockSnapshot {
+    static_assert(std::is_trivially_copyable<T>::value, "SeqlockSnapshot requires a trivially copyable type");
+    static_assert(sizeof(T) % sizeof(size_t) == 0, "SeqlockSnapshot stores T word by word");
+    static constexpr size_t WORDS = sizeof(T) / sizeof(size_t);
+
+public:
+    void Write(const T& value) {
+        size_t words[WORDS];
+        std::memcpy(words, &value, sizeof(T));
+
+        uint64_t seq = _seq.load(std::memory_order_relaxed);
+        _seq.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < WORDS; ++i) {
+            _words[i].store(words[i], std::memory_order_relaxed);
+        }
+        _seq.store(seq + 2, std::memory_order_release);
+    }
+
+    T Read() const {
+        size_t words[WORDS];
+        for (size_t spins = 0;; ++spins) {
+            uint64_t before = _seq.load(std::memory_order_acquire);
+            if ((before & 1) == 0) {
+                for (size_t i = 0; i < WORDS; ++i) {
+                    words[i] = _words[i].load(std::memory_order_relaxed);
+                }
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (_seq.load(std::memory_order_relaxed) == before) break;
+            }
+            // 写者在写到一半时被抢占：让出 CPU，别在单核机器上空转
+            if (spins >= 16) std::this_thread::yield();
+        }
+
+        T value;
+        std::memcpy(&value, words, sizeof(T));
+        return value;
+    }
+
+private:
+    std::atomic<uint64_t> _seq{0};
+    std::atomic<size_t> _words[WORDS] = {};
+};
+
+// =========================================================================
+// 线程级计数 (ThreadCache 在慢速路径上发布)
+// allocatedBytes / freedBytes 例外：它们在快速路径上更新，单独存放 (见 ThreadStatsBlock)
+// =========================================================================
+struct ThreadCounters {
+    size_t fetches = 0;          // 向 CentralCache 进货次数
+    size_t fetchedObjects = 0;   // 累计进货对象数
+    size_t releases = 0;         // 向 CentralCache 归还次数
+    size_t releasedObjects = 0;  // 累计归还对象数
+    size_t budgetTrims = 0;      // 因超出线程缓存预算额外归还的轮数
+    size_t flushes = 0;          // 响应全局冲刷 (内存压力等) 的次数
+    size_t allocatedBytes = 0;   // 累计申请字节数 (按 size class 对齐后的大小，含大对象)
+    size_t freedBytes = 0;       // 累计在本线程释放的字节数 (跨线程释放记在释放方)
+
+    void Accumulate(const ThreadCounters& other) {
+        fetches += other.fetches;
+        fetchedObjects += other.fetchedObjects;
+        releases += other.releases;
+        releasedObjects += other.releasedObjects;
+        budgetTrims += other.budgetTrims;
+        flushes += other.flushes;
+        allocatedBytes += other.allocatedBytes;
+        freedBytes += other.freedBytes;
+    }
+};
+
+// 每个线程一块计数区，挂在注册表的无锁链表上
+// 计数区只增不删：线程退出后计数并入注册表的"已退出"合计，计数区清零留给新线程复用
+// 因此读者在任何时候沿链表遍历都是安全的
+struct ThreadStatsBlock {
+    SeqlockSnapshot<ThreadCounters> _counters;
+    // 字节计数由所属线程在慢速路径上 (或调用 ThreadStats 时) 从 ThreadCache 的本地计数器发布，
+    // 只有所属线程写 (relaxed store)，读者直接原子读；两次发布之间读到的是上一次的值
+    std::atomic<size_t> _allocatedBytes{0};
+    std::atomic<size_t> _freedBytes{0};
+    std::atomic<uint64_t> _tid{0};
+    std::atomic<bool> _inUse{false};
+    ThreadStatsBlock* _next = nullptr; // 压入链表后不再修改
+    // 只有所属线程写 _counters，补齐一个缓存行，避免与相邻计数区伪共享
+    char _pad[CACHE_LINE_SIZE];
+
+    // 慢速路径计数快照 + 字节计数的当前值
+    ThreadCounters Read() const {
+        ThreadCounters counters = _counters.Read();
+        counters.allocatedBytes = _allocatedBytes.load(std::memory_order_relaxed);
+        counters.freedBytes = _freedBytes.load(std::memory_order_relaxed);
+        return counters;
+    }
+};
+
+// 获取当前线程的系统线程号 (只用于展示)
+inline uint64_t CurrentThreadId() {
+#ifdef _WIN32
+    return static_cast<uint64_t>(GetCurrentThreadId());
+#else
+    return static_cast<uint64_t>(syscall(SYS_gettid));
+#endif
+}
+
+// =========================================================================
+// ThreadStatsRegistry
+// 全局单例：登记所有线程的计数区，读取时只沿链表做原子读，不加任何锁
+// =========================================================================
+class ThreadStatsRegistry {
+public:
+    static ThreadStatsRegistry* GetInstance() {
+        alignas(ThreadStatsRegistry) static char _buffer[sizeof(ThreadStatsRegistry)];
+        static ThreadStatsRegistry* _instance = nullptr;
+        static const bool _inited = [&]() {
+            _instance = new (_buffer) ThreadStatsRegistry();
+            return true;
+        }();
+        (void)_inited;
+        return _instance;
+    }
+
+    // 为当前线程领取一块计数区：优先复用已退出线程留下的，否则新建并压入链表头
+    ThreadStatsBlock* Acquire() {
+        for (ThreadStatsBlock* block = _head.load(std::memory_order_acquire); block; block = block->_next) {
+            bool expected = false;
+            if (!block->_inUse.load(std::memory_order_relaxed) &&
+                block->_inUse.compare_exchange_strong(expected, true, std::memory_order_acq_rel)) {
+                block->_tid.store(CurrentThreadId(), std::memory_order_relaxed);
+                return block;
+            }
+        }
+
+        ThreadStatsBlock* block = _pool.New();
+        block->_inUse.store(true, std::memory_order_relaxed);
+        block->_tid.store(CurrentThreadId(), std::memory_order_relaxed);
+        ThreadStatsBlock* head = _head.load(std::memory_order_relaxed);
+        do {
+            block->_next = head;
+        } while (!_head.compare_exchange_weak(head, block, std::memory_order_release, std::memory_order_relaxed));
+        return block;
+    }
+
+    // 线程退出：计数并入已退出合计，清零后交还
+    // 并入与清零之间读者可能瞬间少计或多计一个线程的量，对监控无影响
+    void Retire(ThreadStatsBlock* block) {
+        ThreadCounters counters = block->Read();
+        {
+            std::lock_guard<SpinMutex> lock(_retireMtx);
+            ThreadCounters retired = _retired.Read();
+            retired.Accumulate(counters);
+            _retired.Write(retired);
+        }
+        block->_counters.Write(ThreadCounters());
+        block->_allocatedBytes.store(0, std::memory_order_relaxed);
+        block->_freedBytes.store(0, std::memory_order_relaxed);
+        block->_tid.store(0, std::memory_order_relaxed);
+        block->_inUse.store(false, std::memory_order_release);
+    }
+
+    // 遍历所有存活线程的计数：fn(tid, counters)
+    template <typename Fn>
+    void ForEachThread(Fn&& fn) const {
+        for (ThreadStatsBlock* block = _head.load(std::memory_order_acquire); block; block = block->_next) {
+            if (!block->_inUse.load(std::memory_order_acquire)) continue;
+            fn(block->_tid.load(std::memory_order_relaxed), block->Read());
+        }
+    }
+
+    // 所有线程 (含已退出的) 的合计；liveThreads 非空时返回存活线程数
+    ThreadCounters Total(size_t* liveThreads = nullptr) const {
+        ThreadCounters total = _retired.Read();
+        size_t live = 0;
+        ForEachThread([&](uint64_t, const ThreadCounters& counters) {
+            total.Accumulate(counters);
+            ++live;
+        });
+        if (liveThreads) *liveThreads = live;
+        return total;
+    }
+
+private:
+    ThreadStatsRegistry() = default;
+
+    std::atomic<ThreadStatsBlock*> _head{nullptr};
+    ObjectPool<ThreadStatsBlock> _pool;
+
+    SeqlockSnapshot<ThreadCounters> _retired; // 写者之间用 _retireMtx 串行 (只在线程退出时)
+    SpinMutex _retireMtx;
+};
+
+} // namespace KzAlloc
@@ -0,0 +1,229 @@
+#include "StatsReporter.h"
+#include "PageCache.h"
+#include "CentralCache.h"
+#include "PressureMonitor.h"
+#include "Stats.h"
+#include "FdWriter.h"
+#include <cstring>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <poll.h>
+#endif
+
+namespace KzAlloc {
+
+namespace {
+// 信号处理函数只能碰无锁的原子变量，所以唤醒 fd 单独放一份
+std::atomic<int> g_reportWakeFd{-1};
+} // namespace
+
+#ifdef _WIN32
+
+bool StatsReporter::Start(const StatsReporterOptions&) { return false; }
+void StatsReporter::Stop() {}
+void StatsReporter::RequestReport() {}
+bool StatsReporter::WriteReport(int) { return false; }
+void StatsReporter::Run() {}
+bool StatsReporter::Emit() { return false; }
+void StatsReporter::SignalHandler(int) {}
+
+#else
+
+bool StatsReporter::Start(const StatsReporterOptions& options) {
+    if (options.outputPath == nullptr) return false;
+
+    bool expected = false;
+    if (!_running.compare_exchange_strong(expected, true)) return false;
+    _options = options;
+    if (_options.pollIntervalMs == 0) _options.pollIntervalMs = 1;
+
+    // 1. 输出目标
+    if (std::strcmp(_options.outputPath, "memfd") == 0 && _memfd < 0) {
+#ifdef SYS_memfd_create
+        _memfd = (int)syscall(SYS_memfd_create, "kzalloc-stats", 1 /* MFD_CLOEXEC */);
+#endif
+        if (_memfd < 0) {
+            _running.store(false);
+            return false;
+        }
+    }
+
+    // 2. 自管道 (两端非阻塞：信号处理函数写满时直接丢弃，反正已有待处理的请求)
+    if (pipe2(_wakeFds, O_NONBLOCK | O_CLOEXEC) != 0) {
+        _running.store(false);
+        return false;
+    }
+    g_reportWakeFd.store(_wakeFds[1], std::memory_order_release);
+
+    // 3. 信号
+    if (_options.signalNumber > 0) {
+        struct sigaction action = {};
+        action.sa_handler = &StatsReporter::SignalHandler;
+        sigemptyset(&action.sa_mask);
+        action.sa_flags = SA_RESTART;
+        _handlerInstalled = sigaction(_options.signalNumber, &action, &_oldAction) == 0;
+    }
+
+    _thread = std::thread([this]() { Run(); });
+    return true;
+}
+
+void StatsReporter::Stop() {
+    if (!_running.exchange(false)) return;
+
+    if (_handlerInstalled) {
+        sigaction(_options.signalNumber, &_oldAction, nullptr);
+        _handlerInstalled = false;
+    }
+
+    RequestReport(); // 唤醒后台线程，它看到 _running 为 false 后退出
+    if (_thread.joinable()) _thread.join();
+
+    g_reportWakeFd.store(-1, std::memory_order_release);
+    close(_wakeFds[0]);
+    close(_wakeFds[1]);
+    _wakeFds[0] = _wakeFds[1] = -1;
+}
+
+void StatsReporter::RequestReport() {
+    int fd = g_reportWakeFd.load(std::memory_order_acquire);
+    if (fd >= 0) {
+        char c = 1;
+        ssize_t n = write(fd, &c, 1);
+        (void)n;
+    }
+}
+
+void StatsReporter::SignalHandler(int) {
+    // 异步信号安全：只有 write，且保留被打断代码的 errno
+    int savedErrno = errno;
+    int fd = g_reportWakeFd.load(std::memory_order_acquire);
+    if (fd >= 0) {
+        char c = 1;
+        ssize_t n = write(fd, &c, 1);
+        (void)n;
+    }
+    errno = savedErrno;
+}
+
+void StatsReporter::Run() {
+    while (true) {
+        struct pollfd pfd = {_wakeFds[0], POLLIN, 0};
+        int timeout = _options.controlPath ? (int)_options.pollIntervalMs : -1;
+        int ready = poll(&pfd, 1, timeout);
+
+        bool requested = false;
+        if (ready > 0) {
+            char buf[64];
+            while (read(_wakeFds[0], buf, sizeof(buf)) > 0) {}
+            requested = true;
+        }
+        if (!_running.load(std::memory_order_acquire)) break;
+
+        // 控制文件：出现即触发，删除后等待下一次
+        if (_options.controlPath && access(_options.controlPath, F_OK) == 0) {
+            unlink(_options.controlPath);
+            requested = true;
+        }
+
+        if (requested && Emit()) {
+            _reports.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+}
+
+bool StatsReporter::Emit() {
+    if (_memfd >= 0) {
+        // 每份报告覆盖上一份
+        if (ftruncate(_memfd, 0) != 0) return false;
+        lseek(_memfd, 0, SEEK_SET);
+        return WriteReport(_memfd);
+    }
+
+    // 先写 <path>.tmp，再 rename 覆盖，读者总是看到完整的报告
+    char tmp[4096];
+    int len = std::snprintf(tmp, sizeof(tmp), "%s.tmp", _options.outputPath);
+    if (len <= 0 || (size_t)len >= sizeof(tmp)) return false;
+
+    int fd = open(tmp, O_CREAT | O_TRUNC | O_WRONLY | O_CLOEXEC, 0644);
+    if (fd < 0) return false;
+    bool ok = WriteReport(fd);
+    close(fd);
+    if (!ok || rename(tmp, _options.outputPath) != 0) {
+        unlink(tmp);
+        return false;
+    }
+    return true;
+}
+
+bool StatsReporter::WriteReport(int fd) {
+    SizeUtils::Init();
+    FdWriter out(fd);
+
+    out.Line("# KzAlloc stats report\n");
+    out.Line("pid %d\n", (int)getpid());
+
+    // 1. PageHeap 汇总
+    PageHeap* ph = PageHeap::GetInstance();
+    ReleaseStats pages = ph->SnapshotReleaseStats();
+    out.Line("\n[page heap] (pages of %zu bytes)\n", PAGE_SIZE);
+    out.Line("used_pages %zu\nfree_pages %zu\nrelease_threshold %zu\n",
+             pages.usedPages, pages.freePages, pages.releaseThreshold);
+    out.Line("released_pages %zu\nrelease_events %zu\nrefaulted_pages %zu\nmadvise_calls %zu\n",
+             pages.releasedPages, pages.releaseEvents, pages.refaultedPages, pages.madviseCalls);
+    out.Line("stolen_spans %zu\nstolen_pages %zu\ndeferred_returns %zu\nquick_flushes %zu\n",
+             pages.stolenSpans, pages.stolenPages, pages.deferredReturns, pages.quickFlushes);
+    out.Line("populated_pages %zu\nlock_contended %zu\n", pages.populatedPages, pages.lockContended);
+
+    // 2. 各分片
+    out.Line("\n[shards]\n# shard free_pages used_pages threshold released_pages lock_contended\n");
+    for (size_t i = 0; i < ph->ShardCount(); ++i) {
+        ReleaseStats one;
+        if (!ph->SnapshotShardStats(i, one)) continue;
+        out.Line("%zu %zu %zu %zu %zu %zu\n", i, one.freePages, one.usedPages, one.releaseThreshold,
+                 one.releasedPages, one.lockContended);
+    }
+
+    // 3. CentralCache 各 size class (只列出用到过的)，普通池与长寿命池分开列出
+    CentralCache* cc = CentralCache::GetInstance();
+    for (bool longLived : {false, true}) {
+        out.Line(longLived ? "\n[central cache long-lived]\n" : "\n[central cache]\n");
+        out.Line("# class size spans carved_objs in_use_objs lock_contended\n");
+        for (int i = 0; i < MAX_NFREELISTS; ++i) {
+            CentralClassStats cls = cc->GetClassStats(i, longLived);
+            if (cls.spans == 0 && cls.inUseObjs == 0 && cls.contended == 0) continue;
+            out.Line("%d %zu %zu %zu %zu %zu\n", i, SizeUtils::Size(i), cls.spans, cls.carvedObjs,
+                     cls.inUseObjs, cls.contended);
+        }
+    }
+    EmptySpanStats empty = cc->GetEmptySpanStats();
+    out.Line("empty_span_hits %zu\nempty_span_releases %zu\n", empty.hits, empty.releases);
+
+    // 4. 线程缓存
+    size_t live = 0;
+    ThreadStatsRegistry* registry = ThreadStatsRegistry::GetInstance();
+    ThreadCounters total = registry->Total(&live);
+    out.Line("\n[thread caches]\nlive_threads %zu\n", live);
+    out.Line("total fetches=%zu fetched_objs=%zu releases=%zu released_objs=%zu budget_trims=%zu flushes=%zu "
+             "allocated_bytes=%zu freed_bytes=%zu\n",
+             total.fetches, total.fetchedObjects, total.releases, total.releasedObjects,
+             total.budgetTrims, total.flushes, total.allocatedBytes, total.freedBytes);
+    out.Line("# tid fetches fetched_objs releases released_objs budget_trims flushes allocated_bytes freed_bytes\n");
+    registry->ForEachThread([&](uint64_t tid, const ThreadCounters& c) {
+        out.Line("%llu %zu %zu %zu %zu %zu %zu %zu %zu\n", (unsigned long long)tid, c.fetches, c.fetchedObjects,
+                 c.releases, c.releasedObjects, c.budgetTrims, c.flushes, c.allocatedBytes, c.freedBytes);
+    });
+
+    // 5. 内存压力
+    PressureStats pressure = PressureMonitor::GetInstance()->GetStats();
+    out.Line("\n[pressure]\nunder_pressure %d\nstall_permille %zu\npressure_events %zu\npurges %zu\n",
+             pressure.underPressure ? 1 : 0, (size_t)(pressure.lastStallPercent * 10.0),
+             pressure.pressureEvents, pressure.purges);
+
+    return out.Flush();
+}
+
+#endif
+
+} // namespace KzAlloc
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "Common.h"
+#include <atomic>
+#include <thread>
+
+#ifndef _WIN32
+#include <csignal>
+#endif
+
+namespace KzAlloc {
+
+// =========================================================================
+// StatsReporter (按需导出统计报告)
+// 生产环境挂不上调试器时，用来在线查看分配器状态。后台线程等待触发，然后把完整报告写到：
+// 1. 指定的文件 (先写临时文件再 rename，读者不会看到写了一半的报告)
+// 2. 或者 memfd (路径配置为 "memfd")，通过 /proc/<pid>/fd/<n> 读取
+// 触发方式 (可同时启用)：
+// 1. 信号：处理函数只往自管道 (self-pipe) 写一个字节，是异步信号安全的
+// 2. 控制文件：后台线程周期性检查，文件出现时删除它并生成一份报告
+// 3. 代码中调用 RequestReport()
+// 报告只读取无锁快照 (分片 Seqlock、桶统计、线程计数区)，
+// 格式化到栈上缓冲区后 write，不经过 KzAlloc::malloc
+// 环境变量 KZALLOC_STATS_PATH 设置后，PageHeap 初始化时自动启动，
+// 可配合 KZALLOC_STATS_SIGNAL (信号编号) 与 KZALLOC_STATS_CONTROL (控制文件路径)
+// =========================================================================
+
+struct StatsReporterOptions {
+    const char* outputPath = nullptr;  // 报告路径，"memfd" 表示写入匿名内存文件
+    int signalNumber = 0;              // 触发信号 (如 SIGUSR2)，0 表示不安装处理函数
+    const char* controlPath = nullptr; // 控制文件路径，nullptr 表示不检查
+    uint32_t pollIntervalMs = 1000;    // 检查控制文件的周期
+};
+
+class StatsReporter {
+public:
+    static StatsReporter* GetInstance() {
+        alignas(StatsReporter) static char _buffer[sizeof(StatsReporter)];
+        static StatsReporter* _instance = nullptr;
+        static const bool _inited = [&]() {
+            _instance = new (_buffer) StatsReporter();
+            return true;
+        }();
+        (void)_inited;
+        return _instance;
+    }
+
+    // 启动后台线程；已在运行或输出目标无法打开时返回 false
+    // 注意：options 中的字符串必须在运行期间一直有效
+    bool Start(const StatsReporterOptions& options);
+
+    // 停止后台线程，恢复原来的信号处理函数 (memfd 保留，已写出的报告仍可读取)
+    void Stop();
+
+    // 请求生成一份报告 (异步，由后台线程完成)；也可以在信号处理函数中调用
+    void RequestReport();
+
+    // 立即把报告写入 fd (调用线程同步完成)，写入失败返回 false
+    static bool WriteReport(int fd);
+
+    // memfd 模式下报告所在的 fd，否则返回 -1
+    int MemFd() const { return _memfd; }
+
+    // 已生成的报告份数
+    size_t ReportCount() const { return _reports.load(std::memory_order_relaxed); }
+
+private:
+    StatsReporter() = default;
+
+    void Run();
+
+    // 写到配置的输出目标
+    bool Emit();
+
+    static void SignalHandler(int signo);
+
+private:
+    StatsReporterOptions _options;
+    std::thread _thread;
+    std::atomic<bool> _running{false};
+    std::atomic<size_t> _reports{0};
+
+    int _memfd = -1;
+    int _wakeFds[2] = {-1, -1}; // 自管道：[0] 后台线程 poll，[1] 信号处理函数写入
+    bool _handlerInstalled = false;
+#ifndef _WIN32
+    struct sigaction _oldAction = {};
+#endif
+};
+
+} // namespace KzAlloc
@@ -8,6 +8,20 @@ namespace KzAlloc {
 void* ThreadCache::Allocate(size_t size) {
     // 1. 计算桶索引
     int index = SizeUtils::Index(size);
+    AccountAlloc(SizeUtils::Size(index));
+
+#ifdef KZALLOC_USE_MAGAZINE
+    // 弹匣前端：一次下标读取，没有指针追逐
+    // 扩展规格不走弹匣：一只弹匣 64 个 MB 级对象就是几十 MB 的囤积
+    if (index < BASE_NFREELISTS) [[likely]] {
+        Magazine* mag = _loaded[index];
+        if (mag && !mag->Empty()) [[likely]] {
+            return mag->Pop();
+        }
+        return MagazineAllocSlow(index, size);
+    }
+#endif
+
     FreeList& list = _freeLists[index];
 
     // 2. 优先从 FreeList 拿 (Hot Path - 极速)
@@ -16,7 +30,7 @@ void* ThreadCache::Allocate(size_t size) {
     }
 
     // 3. 没货了，找 CentralCache 进货 (Cold Path)
-    return FetchFromCentralCache(index, size);
+    return FetchFromCentralCache(list, size);
 }
 
 void ThreadCache::Deallocate(void* ptr, size_t size) {
@@ -24,6 +38,20 @@ void ThreadCache::Deallocate(void* ptr, size_t size) {
 
     // 1. 计算桶索引
     int index = SizeUtils::Index(size);
+    AccountFree(SizeUtils::Size(index));
+
+#ifdef KZALLOC_USE_MAGAZINE
+    // 弹匣前端：一次下标写入，不触碰对象本身
+    if (index < BASE_NFREELISTS) [[likely]] {
+        Magazine* mag = _loaded[index];
+        if (mag && !mag->Full()) [[likely]] {
+            mag->Push(ptr);
+            return;
+        }
+        MagazineFreeSlow(ptr, index, size);
+        return;
+    }
+#endif
 
     FreeList& list = _freeLists[index];
 
@@ -31,32 +59,148 @@ void ThreadCache::Deallocate(void* ptr, size_t size) {
     list.Push(ptr);
 
     // 3. 检测是否囤积了太多内存
-    // 如果当前链表长度 > 慢启动阈值，说明该线程可能只是短时间突发分配，
-    // 现在不需要这么多了，归还一部分给 CentralCache，避免内存泄露式占用。
-    if (list.Size() >= list.MaxSize() + list.MaxNum()) {
+    // 如果当前链表长度超过 慢启动阈值 + 一个归还批量，说明该线程释放多于申请，
+    // 归还一批给 CentralCache，避免内存泄露式占用。
+    if (list.Size() >= list.MaxSize() + list.TransferNum()) {
         ListTooLong(list, size);
     }
 }
 
-void* ThreadCache::FetchFromCentralCache(size_t index, size_t size) {
-    FreeList& list = _freeLists[index];
+void* ThreadCache::AllocateLongLived(size_t size) {
+    int index = SizeUtils::Index(size);
+    AccountAlloc(SizeUtils::Size(index));
+
+    // 不走弹匣：弹匣里的对象来自普通 Span 池
+    FreeList& list = LongLivedList(index);
+    if (!list.Empty()) {
+        return list.Pop();
+    }
+    return FetchFromCentralCache(list, size);
+}
+
+void ThreadCache::DeallocateLongLived(void* ptr, size_t size) {
+    assert(ptr);
+    int index = SizeUtils::Index(size);
+    AccountFree(SizeUtils::Size(index));
+
+    FreeList& list = LongLivedList(index);
+    list.Push(ptr);
+    if (list.Size() >= list.MaxSize() + list.TransferNum()) {
+        ListTooLong(list, size);
+    }
+}
+
+void* ThreadCache::AllocateIsolated(size_t size) {
+    size_t index = SizeUtils::IsolatedIndex(size);
+    AccountAlloc(SizeUtils::IsolatedClassSize(index));
+
+    FreeList& list = IsolatedList(index);
+    if (!list.Empty()) {
+        return list.Pop();
+    }
+    return FetchFromCentralCache(list, size);
+}
+
+void ThreadCache::DeallocateIsolated(void* ptr, size_t size) {
+    assert(ptr);
+    size_t index = SizeUtils::IsolatedIndex(size);
+    AccountFree(SizeUtils::IsolatedClassSize(index));
+
+    FreeList& list = IsolatedList(index);
+    list.Push(ptr);
+    if (list.Size() >= list.MaxSize() + list.TransferNum()) {
+        ListTooLong(list, size);
+    }
+}
+
+void* ThreadCache::AllocateFrame(size_t size) {
+    // 槽位从前往后认领，遇到空闲槽位说明后面也没有
+    for (FrameSlot& slot : _frames) {
+        if (slot._size != size) {
+            if (slot._size == 0) break;
+            continue;
+        }
+        if (slot._head) [[likely]] {
+            void* ptr = slot._head;
+            slot._head = NextObj(ptr);
+            slot._count--;
+            AccountAlloc(slot._bytes);
+            return ptr;
+        }
+        break;
+    }
+    return Allocate(size);
+}
+
+void ThreadCache::DeallocateFrame(void* ptr, size_t size) {
+    assert(ptr);
+    for (FrameSlot& slot : _frames) {
+        if (slot._size == 0) {
+            // 认领空闲槽位
+            slot._size = size;
+            slot._bytes = SizeUtils::RoundUp(size);
+            slot._depth = std::clamp<size_t>(FRAME_SLOT_BYTES / slot._bytes, 1, FRAME_SLOT_DEPTH);
+        } else if (slot._size != size) {
+            continue;
+        }
+        if (slot._count < slot._depth) {
+            NextObj(ptr) = slot._head;
+            slot._head = ptr;
+            slot._count++;
+            AccountFree(slot._bytes);
+            return;
+        }
+        break;
+    }
+    // 槽位已满或帧大小种类超过 FRAME_SLOTS
+    Deallocate(ptr, size);
+}
+
+void ThreadCache::ReleaseFrames() {
+    for (FrameSlot& slot : _frames) {
+        if (slot._head) {
+            CentralCache::GetInstance()->ReleaseListToSpans(slot._head, slot._bytes);
+            _releaseCount++;
+            _releasedObjs += slot._count;
+        }
+        slot = FrameSlot();
+    }
+}
+
+void* ThreadCache::FetchFromCentralCache(FreeList& list, size_t size) {
 
     // 1. 慢启动策略：计算本次应该向 CentralCache 批发多少个
     // 初始 _maxSize 为 1
-    // 每次 Fetch，_maxSize + 1，直到达到上限 (例如 512)
+    // 每次 miss，_maxSize 翻倍，直到达到上限 NumMoveSize
     // 这样小对象用得多，批发就多；大对象用得少，批发就少
-    size_t batchNum = std::min(list.MaxSize() << 1, list.MaxNum());
-    list.SetMaxSize(batchNum); // 更新慢启动阈值
+    // 已到 NumMoveSize 且本周期溢出过 (工作集在"申请一批、释放一批"之间来回，比上限大)：
+    // 上限再加一个批量 (最多 MAX_LIST_BYTES)，让链表装得下整个来回，不再每轮都还了又取
+    // 一次性的突发只缺货不溢出，不会走到这里
+    // 上限不是单调的：持续溢出或空闲时会在 Scavenge 中收缩
+    list.RecordMiss();
+    size_t maxSize = list.MaxSize();
+    if (maxSize < list.MaxNum()) {
+        maxSize = std::min(maxSize << 1, list.MaxNum());
+    } else if (_adaptive && list.OverflowCount() > 0) {
+        maxSize = std::min(maxSize + list.MaxNum(), std::max(list.MaxNum(), MAX_LIST_BYTES / size));
+    }
+    list.SetMaxSize(maxSize); // 更新慢启动阈值
+    size_t batchNum = std::min(maxSize, list.MaxNum());
 
     // 2. 向 CentralCache 申请
     void* start = nullptr;
     void* end = nullptr;
     
     // fetchNum 可能会比 batchNum 少 (CentralCache 也没货了)
-    size_t fetchNum = CentralCache::GetInstance()->FetchRangeObj(start, end, batchNum, size);
+    CentralCache* cc = CentralCache::GetInstance();
+    size_t fetchNum = list.Isolated() ? cc->FetchIsolatedRange(start, end, batchNum, size)
+                                      : cc->FetchRangeObj(start, end, batchNum, size, list.LongLived());
 
     assert(fetchNum >= 1);
 
+    _fetchCount++;
+    _fetchedObjs += fetchNum;
+
     // 3. 返回第一个对象给用户
     void* ret = start;
 
@@ -70,25 +214,378 @@ void* ThreadCache::FetchFromCentralCache(size_t index, size_t size) {
         list.PushRange(remainStart, end, fetchNum - 1);
     }
 
+    Tick();
     return ret;
 }
 
 void ThreadCache::ListTooLong(FreeList& list, size_t size) {
+    // 1. 决定归还多少个
+    // 策略：每次只归还一个 TransferNum 批量，而不是整个 MaxNum。
+    // 批量按字节定 (TRANSFER_BYTES)，小对象一次还得多，大对象一次还得少。
+    ReleaseToCentral(list, list.TransferNum(), size);
+
+    // 2. 反馈：记录溢出，周期结束时 (Scavenge) 如果该链表只溢出没有 miss，就收缩上限
+    // 不在这里立即收缩：一次大批量释放会连续溢出很多次，立即收缩会把上限一路打到底，
+    // 下一轮申请又要从 1 开始慢启动
+    list.RecordOverflow();
+
+    Tick();
+}
+
+void ThreadCache::ReleaseToCentral(FreeList& list, size_t n, size_t size) {
     void* start = nullptr;
     void* end = nullptr;
 
-    // 1. 决定归还多少个
-    // 策略：归还当前 _maxSize 的数量。
-    // 这保证了 ThreadCache 依然保留一部分热数据 (_maxSize 个)，
-    // 同时把多出来的部分还回去。
-    size_t popNum = list.MaxNum();
-
-    // 2. 从 FreeList 剥离出链表
-    list.PopRange(start, end, popNum);
+    // 1. 从 FreeList 剥离出链表
+    list.PopRange(start, end, n);
 
-    // 3. 归还给 CentralCache
+    // 2. 归还给 CentralCache
     // 这里的 start 是链表头，CentralCache 会处理遍历
+    if (list.Isolated()) {
+        CentralCache::GetInstance()->ReleaseIsolatedList(start);
+    } else {
+        CentralCache::GetInstance()->ReleaseListToSpans(start, size, list.LongLived());
+    }
+    _releaseCount++;
+    _releasedObjs += n;
+}
+
+void ThreadCache::Scavenge() {
+    _slowEvents = 0;
+    _lastScavengeMs = NowMilliseconds();
+
+    size_t cached = 0;
+    ForEachList([&](FreeList& list, size_t size) {
+        // 1. 低水位 > 0：这些对象整个周期都没被用到，归还一半
+        size_t lowWater = list.LowWater();
+        if (lowWater > 0) {
+            size_t n = (lowWater + 1) >> 1;
+            ReleaseToCentral(list, n, size);
+        }
+
+        // 2. 整个周期没有 miss，但发生过溢出或有闲置对象，说明上限偏大，减半
+        if (list.MissCount() == 0 && (list.OverflowCount() > 0 || lowWater > 0) && list.MaxSize() > 1) {
+            list.SetMaxSize(list.MaxSize() >> 1);
+        }
+
+        list.ResetPeriod();
+        cached += list.Size() * size;
+    });
+
+#ifdef KZALLOC_USE_MAGAZINE
+    // 弹匣里的对象同样计入预算
+    for (int i = 0; i < MAX_NFREELISTS; ++i) {
+        size_t objs = 0;
+        if (_loaded[i]) objs += _loaded[i]->_count;
+        if (_previous[i]) objs += _previous[i]->_count;
+        cached += objs * SizeUtils::Size(i);
+    }
+#endif
+
+    // 3. 超出预算 (例如容器内存很小)：各链表再归还一半并收紧上限
+    size_t budget = ThreadCacheBudget();
+    while (cached > budget) {
+        size_t released = 0;
+#ifdef KZALLOC_USE_MAGAZINE
+        // 先倒空备用的 previous 弹匣 (满或空，倒空后仍满足双弹匣的不变式)
+        for (int i = 0; i < MAX_NFREELISTS; ++i) {
+            Magazine* mag = _previous[i];
+            if (mag && !mag->Empty()) {
+                released += mag->_count * SizeUtils::Size(i);
+                ReleaseMagazine(mag, SizeUtils::Size(i));
+            }
+        }
+#endif
+        ForEachList([&](FreeList& list, size_t size) {
+            size_t n = (list.Size() + 1) >> 1;
+            if (n == 0) return;
+            ReleaseToCentral(list, n, size);
+            released += n * size;
+            if (list.MaxSize() > 1) list.SetMaxSize(list.MaxSize() >> 1);
+            list.ResetPeriod();
+        });
+        if (released == 0) break;
+        cached -= released;
+        _budgetTrims++;
+    }
+
+    // 4. 顺带清扫 CentralCache 中超时的空 Span，并叫醒其他线程按时间回收 (都是全局限速)
+    CentralCache::GetInstance()->SweepEmptySpans();
+    WakeAllPeriodically();
+}
+
+void ThreadCache::Housekeeping() {
+    if (!CheckFlushEpoch()) {
+        ScavengeByTime();
+    }
+    if (_allocatedBytes >= _quotaCheckAt) {
+        CheckQuota(_allocatedBytes);
+    }
+    ArmCheck();
+}
+
+void ThreadCache::ScavengeByTime() {
+    if (!_adaptive) return;
+    uint64_t elapsed = NowMilliseconds() - _lastScavengeMs;
+    if (elapsed < SCAVENGE_PERIOD_MS) return;
+    size_t rounds = std::min<uint64_t>(elapsed / SCAVENGE_PERIOD_MS, IDLE_SCAVENGE_ROUNDS);
+    for (size_t i = 0; i < rounds; ++i) {
+        Scavenge();
+    }
+#ifdef KZALLOC_USE_MAGAZINE
+    // 弹匣没有低水位可看：两个周期以上没有检查过，视为空闲，弹匣里的对象全部还回去 (弹匣留着复用)
+    if (rounds >= 2) {
+        for (int i = 0; i < MAX_NFREELISTS; ++i) {
+            for (Magazine* mag : {_loaded[i], _previous[i]}) {
+                if (mag && !mag->Empty()) ReleaseMagazine(mag, SizeUtils::Size(i));
+            }
+        }
+    }
+#endif
+    PublishStats();
+}
+
+void ThreadCache::SetAdaptive(bool adaptive) {
+    _adaptive = adaptive;
+    InitLists(_freeLists, false);
+    if (_longLived) InitLists(_longLived->_lists, true);
+    if (_isolated) InitIsolatedLists();
+}
+
+void ThreadCache::Register() {
+    std::lock_guard<SpinMutex> lock(_cachesMtx);
+    _nextCache = _caches;
+    if (_caches) _caches->_prevCache = this;
+    _caches = this;
+}
+
+void ThreadCache::Unregister() {
+    std::lock_guard<SpinMutex> lock(_cachesMtx);
+    if (_prevCache) _prevCache->_nextCache = _nextCache;
+    else _caches = _nextCache;
+    if (_nextCache) _nextCache->_prevCache = _prevCache;
+}
+
+void ThreadCache::WakeAll() {
+    std::lock_guard<SpinMutex> lock(_cachesMtx);
+    for (ThreadCache* tc = _caches; tc; tc = tc->_nextCache) {
+        tc->_checkAt.store(0, std::memory_order_seq_cst);
+    }
+}
+
+void ThreadCache::WakeAllPeriodically() {
+    uint64_t now = NowMilliseconds();
+    uint64_t last = _lastWakeMs.load(std::memory_order_relaxed);
+    if (now - last < SCAVENGE_PERIOD_MS) return;
+    if (!_lastWakeMs.compare_exchange_strong(last, now, std::memory_order_relaxed)) return;
+    WakeAll();
+}
+
+void ThreadCache::ReleaseAll() {
+    for (int i = 0; i < MAX_NFREELISTS; ++i) {
+        FreeList& list = _freeLists[i];
+        if (list.Size() > 0) {
+            ReleaseToCentral(list, list.Size(), SizeUtils::Size(i));
+        }
+        list.SetMaxSize(1);
+        list.ResetPeriod();
+
+#ifdef KZALLOC_USE_MAGAZINE
+        // 弹匣本身留着复用，只把里面的对象还回去
+        for (Magazine* mag : {_loaded[i], _previous[i]}) {
+            if (mag && !mag->Empty()) {
+                ReleaseMagazine(mag, SizeUtils::Size(i));
+            }
+        }
+#endif
+    }
+#ifdef KZALLOC_USE_MAGAZINE
+    // Depot 里的满弹匣也一并倒空，否则每个桶最多还囤着 MAX_DEPOT_MAGAZINES 只
+    CentralCache::GetInstance()->ReleaseMagazineDepots();
+#endif
+
+    if (_longLived) {
+        for (int i = 0; i < MAX_NFREELISTS; ++i) {
+            FreeList& list = _longLived->_lists[i];
+            if (list.Size() > 0) {
+                ReleaseToCentral(list, list.Size(), SizeUtils::Size(i));
+            }
+            list.SetMaxSize(1);
+            list.ResetPeriod();
+        }
+    }
+    if (_isolated) {
+        for (size_t i = 0; i < ISOLATED_NCLASSES; ++i) {
+            FreeList& list = _isolated->_lists[i];
+            if (list.Size() > 0) {
+                ReleaseToCentral(list, list.Size(), SizeUtils::IsolatedClassSize(i));
+            }
+            list.SetMaxSize(1);
+            list.ResetPeriod();
+        }
+    }
+    ReleaseFrames();
+    PublishStats();
+}
+
+size_t ThreadCache::CachedBytes() const {
+    size_t bytes = 0;
+    for (int i = 0; i < MAX_NFREELISTS; ++i) {
+        size_t objs = _freeLists[i].Size();
+#ifdef KZALLOC_USE_MAGAZINE
+        if (_loaded[i]) objs += _loaded[i]->_count;
+        if (_previous[i]) objs += _previous[i]->_count;
+#endif
+        if (_longLived) objs += _longLived->_lists[i].Size();
+        bytes += objs * SizeUtils::Size(i);
+    }
+    if (_isolated) {
+        for (size_t i = 0; i < ISOLATED_NCLASSES; ++i) {
+            bytes += _isolated->_lists[i].Size() * SizeUtils::IsolatedClassSize(i);
+        }
+    }
+    for (const FrameSlot& slot : _frames) bytes += slot._count * slot._bytes;
+    return bytes;
+}
+
+void ThreadCache::SetQuota(size_t quotaBytes, ThreadQuotaCallback callback, void* context) {
+    if (quotaBytes == 0 || callback == nullptr) {
+        _quotaBytes = 0;
+        _quotaCallback = nullptr;
+        _quotaContext = nullptr;
+        _quotaCheckAt = SIZE_MAX;
+        ArmCheck();
+        return;
+    }
+    _quotaBytes = quotaBytes;
+    _quotaCallback = callback;
+    _quotaContext = context;
+    // 下一次申请时重新计算 (设置时可能已经超额)
+    _quotaCheckAt = 0;
+    ArmCheck();
+}
+
+void ThreadCache::CheckQuota(size_t allocated) {
+    // 本线程释放了别的线程申请的对象时，释放量可能超过申请量
+    size_t freed = _freedBytes;
+    size_t live = allocated > freed ? allocated - freed : 0;
+
+    if (live <= _quotaBytes) {
+        // 释放只会让净值变小，累计申请量至少再增加 (配额 - 净值) 才可能超额，在那之前不用检查
+        _quotaCheckAt = allocated + (_quotaBytes - live) + 1;
+        return;
+    }
+
+    // 超额：先推迟下一次检查再回调，回调里的申请不会递归触发
+    size_t step = std::max(_quotaBytes / 4, PAGE_SIZE);
+    _quotaCheckAt = allocated + step;
+    _quotaCallback(live, _quotaBytes, _quotaContext);
+}
+
+#ifdef KZALLOC_USE_MAGAZINE
+void* ThreadCache::MagazineAllocSlow(size_t index, size_t size) {
+    CheckFlushEpoch();
+    Magazine*& loaded = _loaded[index];
+    Magazine*& previous = _previous[index];
+
+    if (loaded == nullptr) {
+        loaded = NewMagazine(index);
+    }
+
+    // 1. previous 是满的：直接交换
+    if (previous && !previous->Empty()) {
+        std::swap(loaded, previous);
+        return loaded->Pop();
+    }
+
+    // 2. Depot 有满弹匣：整只换过来，空弹匣留作 previous
+    Magazine* full = CentralCache::GetInstance()->PopFullMagazine(index);
+    if (full) {
+        if (previous == nullptr) {
+            previous = loaded;
+        } else {
+            GetMagazinePool().Delete(loaded);
+        }
+        loaded = full;
+        void* obj = loaded->Pop();
+        Tick();
+        return obj;
+    }
+
+    // 3. 都没有：从 Span 进货装满 loaded
+    // 只有这里需要沿着 Span 的空闲链表走一遍
+    void* start = nullptr;
+    void* end = nullptr;
+    size_t fetchNum = CentralCache::GetInstance()->FetchRangeObj(start, end, loaded->_capacity, size);
+    assert(fetchNum >= 1);
+    _fetchCount++;
+    _fetchedObjs += fetchNum;
+
+    void* cur = start;
+    for (size_t i = 0; i < fetchNum; ++i) {
+        void* next = NextObj(cur);
+        loaded->Push(cur);
+        cur = next;
+    }
+    void* obj = loaded->Pop();
+    Tick();
+    return obj;
+}
+
+void ThreadCache::ReleaseMagazine(Magazine* mag, size_t size) {
+    void* end = nullptr;
+    size_t n = mag->_count;
+    void* start = mag->Link(end);
+    mag->_count = 0;
     CentralCache::GetInstance()->ReleaseListToSpans(start, size);
+    _releaseCount++;
+    _releasedObjs += n;
+}
+
+void ThreadCache::MagazineFreeSlow(void* ptr, size_t index, size_t size) {
+    Magazine*& loaded = _loaded[index];
+    Magazine*& previous = _previous[index];
+
+    // 冲刷后 loaded 变空，直接装进去即可
+    if (CheckFlushEpoch() && loaded) {
+        loaded->Push(ptr);
+        return;
+    }
+
+    if (loaded == nullptr) {
+        loaded = NewMagazine(index);
+        loaded->Push(ptr);
+        return;
+    }
+
+    // loaded 已满
+    // 1. previous 是空的：直接交换
+    if (previous && previous->Empty()) {
+        std::swap(loaded, previous);
+        loaded->Push(ptr);
+        return;
+    }
+
+    // 2. 还没有 previous：loaded 降级为 previous，新开一只空弹匣
+    if (previous == nullptr) {
+        previous = loaded;
+        loaded = NewMagazine(index);
+        loaded->Push(ptr);
+        return;
+    }
+
+    // 3. 两只都满：把 previous 整只交给 Depot
+    if (CentralCache::GetInstance()->PushFullMagazine(index, previous)) {
+        previous = loaded;
+        loaded = NewMagazine(index);
+    } else {
+        // Depot 也满了：把 previous 里的对象串成链表还给 Span，然后复用这只空弹匣
+        ReleaseMagazine(previous, size);
+        std::swap(loaded, previous);
+    }
+    loaded->Push(ptr);
+    Tick();
 }
+#endif
 
 } // namespace KzAlloc
\ No newline at end of file
@@ -2,9 +2,72 @@
 
 #include "Common.h"
 #include "CentralCache.h"
+#include "ObjectPool.h"
+#include "Stats.h"
+#include "SpinLock.h"
+#include <atomic>
+#include <cstdlib>
+#include <mutex>
 
 namespace KzAlloc {
 
+// 自适应批量参数
+// 单次向 CentralCache 归还的字节数目标 (决定归还批量 TransferNum)
+static constexpr size_t TRANSFER_BYTES = 64 * 1024;
+// 反复"溢出又缺货"的链表可以把上限提到一个批量以上，单条链表最多缓存这么多字节
+static constexpr size_t MAX_LIST_BYTES = 2 * 1024 * 1024;
+// 每发生多少次慢速路径事件 (进货/归还) 做一次空闲回收
+static constexpr size_t SCAVENGE_INTERVAL = 256;
+// 不走慢速路径的线程按时间回收：距上一次回收超过这么久就补做 (每错过一个周期做一轮，最多 IDLE_SCAVENGE_ROUNDS 轮)
+static constexpr uint64_t SCAVENGE_PERIOD_MS = 1000;
+static constexpr size_t IDLE_SCAVENGE_ROUNDS = 8;
+// 快速路径上每累计申请这么多字节做一次 Housekeeping (与配额检查共用一次比较)
+static constexpr size_t HOUSEKEEPING_BYTES = 256 * 1024;
+
+// 单个线程缓存的字节预算：可用内存 (物理内存与 cgroup 限制取小) 的 1/512，夹在 [2MB, 64MB]
+// 超出时 Scavenge 会额外归还；环境变量 KZALLOC_THREAD_CACHE_BYTES 可以强制指定
+static constexpr size_t MIN_THREAD_CACHE_BUDGET = 2 * 1024 * 1024;
+static constexpr size_t MAX_THREAD_CACHE_BUDGET = 64 * 1024 * 1024;
+
+inline size_t ThreadCacheBudget() {
+    static const size_t budget = []() {
+        const char* env = std::getenv("KZALLOC_THREAD_CACHE_BYTES");
+        if (env) {
+            size_t val = std::strtoull(env, nullptr, 10);
+            if (val > 0) return val;
+        }
+        size_t val = GetEffectiveMemoryLimit() / 512;
+        if (val < MIN_THREAD_CACHE_BUDGET) val = MIN_THREAD_CACHE_BUDGET;
+        if (val > MAX_THREAD_CACHE_BUDGET) val = MAX_THREAD_CACHE_BUDGET;
+        return val;
+    }();
+    return budget;
+}
+
+// 全局冲刷纪元：每加一次，所有 ThreadCache 在下一次申请时 (快速路径也算，见 Housekeeping)
+// 或下一次慢速路径上把缓存全部还给 CentralCache (内存压力监控等场景使用)
+inline std::atomic<uint64_t> g_threadCacheFlushEpoch{0};
+
+// 协程帧回收链表 (KzPromiseAllocator 使用，见 KzCoroutine.h)
+// 一个程序里的协程帧通常只有少数几种大小：每种大小一条按请求字节数精确匹配的短链表，
+// 命中时省掉 Index 查表和慢启动/溢出判断。槽位按首次释放的顺序认领，之后不再变更
+static constexpr size_t FRAME_SLOTS = 4;
+static constexpr size_t FRAME_SLOT_DEPTH = 64;        // 每条链表最多缓存的帧数
+static constexpr size_t FRAME_SLOT_BYTES = 64 * 1024; // 每条链表最多缓存的字节数
+
+struct FrameSlot {
+    size_t _size = 0;  // 帧的请求大小，0 表示槽位空闲
+    size_t _bytes = 0; // 对应规格的大小 (字节计数用)
+    void* _head = nullptr;
+    size_t _count = 0;
+    size_t _depth = 0; // 本槽位的容量，按帧大小折算
+};
+
+// 线程软配额回调：本线程净申请字节数 (申请 - 释放) 超过配额时调用
+// 在触发它的那次 malloc 内部、对象出链之前调用，回调里可以再申请/释放内存
+// 软配额只负责提醒，不拒绝分配；超额期间每再净增 1/4 配额提醒一次
+using ThreadQuotaCallback = void (*)(size_t liveBytes, size_t quotaBytes, void* context);
+
 // 专门为 ThreadCache 设计的轻量级单向自由链表
 // 记录了 tail 和 size，支持 O(1) 的区间插入和删除
 class FreeList {
@@ -31,6 +94,9 @@ public:
             _tail = nullptr;
         }
         _size--;
+        // 低水位：本回收周期内链表最短时的长度
+        // 低水位 > 0 说明这些对象整个周期都没被用到
+        if (_size < _lowWater) _lowWater = _size;
         
         return obj;
     }
@@ -82,14 +148,41 @@ public:
         }
         
         _size -= n;
+        if (_size < _lowWater) _lowWater = _size;
     }
 
     bool Empty() const { return _head == nullptr; }
     size_t Size() const { return _size; }
     size_t MaxSize() const { return _maxSize; }
     size_t MaxNum() const { return _maxNum; }
+    size_t TransferNum() const { return _transferNum; }
     void SetMaxSize(size_t maxSize) { _maxSize = maxSize; }
     void SetMaxNum(size_t maxNum) { _maxNum = maxNum; }
+    void SetTransferNum(size_t transferNum) { _transferNum = transferNum; }
+    bool LongLived() const { return _longLived; }
+    void SetLongLived(bool longLived) { _longLived = longLived; }
+    bool Isolated() const { return _isolated; }
+    void SetIsolated(bool isolated) { _isolated = isolated; }
+
+    // ---------------------------------------------------------
+    // 反馈统计 (只在慢速路径上读写)
+    // ---------------------------------------------------------
+    size_t LowWater() const { return _lowWater; }
+    size_t MissCount() const { return _missCount; }
+    size_t OverflowCount() const { return _overflowCount; }
+
+    // 本链表为空导致一次进货
+    void RecordMiss() { _missCount++; }
+
+    // 本链表过长导致一次归还
+    void RecordOverflow() { _overflowCount++; }
+
+    // 开始新的回收周期
+    void ResetPeriod() {
+        _lowWater = _size;
+        _missCount = 0;
+        _overflowCount = 0;
+    }
 
 
 private:
@@ -98,15 +191,54 @@ private:
     size_t _size = 0;      // 当前链表长度
     size_t _maxSize = 1;   // 慢启动阈值 (限制该链表最大能挂多少个)
     size_t _maxNum;        // _maxSize上限，由构造函数赋值
+    size_t _transferNum = 1; // 单次归还给 CentralCache 的数量
+    size_t _lowWater = 0;  // 本周期内的最短长度
+    size_t _missCount = 0; // 本周期内的 miss 次数
+    size_t _overflowCount = 0; // 本周期内的溢出次数
+    bool _longLived = false;   // 缓存的是长寿命 Span 池的对象
+    bool _isolated = false;    // 缓存的是隔离 Span 池的对象
 };
 
+// 按对象大小设置本地链表的批量上限与归还批量 (ThreadCache 与 BasicAllocator 共用)
+inline void InitListBatch(FreeList& list, size_t size) {
+    size_t maxNum = SizeUtils::detail::_NumMoveSize(size);
+    size_t transferNum = TRANSFER_BYTES / size;
+    if (transferNum < 2) transferNum = 2;
+    if (transferNum > maxNum) transferNum = maxNum;
+    list.SetMaxNum(maxNum);
+    list.SetTransferNum(transferNum);
+}
+
 class ThreadCache {
 public:
 
     explicit ThreadCache() {
-       for (int i = 0; i < MAX_NFREELISTS; ++i) {
-        _freeLists[i].SetMaxNum(SizeUtils::NumMoveSize(i));
-       }
+       // 保证桶映射表已初始化 (call_once，之后只是一次原子读)
+       SizeUtils::Init();
+       InitLists(_freeLists, false);
+       Register();
+    }
+
+    ~ThreadCache() {
+        Unregister();
+        ReleaseFrames();
+        if (_longLived) {
+            // 长寿命对象的 Span 本来就难以清空，线程退出时不能再让本地缓存钉住它们
+            for (int i = 0; i < MAX_NFREELISTS; ++i) {
+                FreeList& list = _longLived->_lists[i];
+                if (list.Size() > 0) ReleaseToCentral(list, list.Size(), SizeUtils::Size(i));
+            }
+            GetLongLivedPool().Delete(_longLived);
+        }
+        if (_isolated) {
+            for (size_t i = 0; i < ISOLATED_NCLASSES; ++i) {
+                FreeList& list = _isolated->_lists[i];
+                if (list.Size() > 0) ReleaseToCentral(list, list.Size(), SizeUtils::IsolatedClassSize(i));
+            }
+            GetIsolatedPool().Delete(_isolated);
+        }
+        PublishBytes();
+        ThreadStatsRegistry::GetInstance()->Retire(_stats);
     }
     // 申请内存
     void* Allocate(size_t size);
@@ -114,17 +246,308 @@ public:
     // 释放内存
     void Deallocate(void* ptr, size_t size);
 
-    // 从 CentralCache 获取对象
-    void* FetchFromCentralCache(size_t index, size_t size);
+    // 长寿命对象：使用单独的本地链表和 CentralCache 的长寿命 Span 池
+    // 本地链表在第一次使用时才创建，从不使用提示的线程没有额外开销
+    void* AllocateLongLived(size_t size);
+    void DeallocateLongLived(void* ptr, size_t size);
+
+    // 隔离对象 (size <= ISOLATED_MAX_BYTES)：专用规格的本地链表，对接 CentralCache 的隔离 Span 池
+    // 与长寿命链表一样按需创建
+    void* AllocateIsolated(size_t size);
+    void DeallocateIsolated(void* ptr, size_t size);
+
+    // 协程帧：先查本线程的帧回收链表，未命中再走普通路径
+    void* AllocateFrame(size_t size);
+    void DeallocateFrame(void* ptr, size_t size);
+
+    // 从 CentralCache 获取对象，补充到 list (按链表所属的 Span 池)
+    void* FetchFromCentralCache(FreeList& list, size_t size);
 
     // 释放过多内存给 CentralCache
     void ListTooLong(FreeList& list, size_t size);
 
+    // ---------------------------------------------------------
+    // 统计接口 (本线程读取)
+    // ---------------------------------------------------------
+    size_t FetchCount() const { return _fetchCount; }      // 向 CentralCache 进货次数
+    size_t FetchedObjects() const { return _fetchedObjs; } // 累计进货对象数
+    size_t ReleaseCount() const { return _releaseCount; }  // 向 CentralCache 归还次数
+    size_t BudgetTrims() const { return _budgetTrims; }    // 因超出预算额外归还的轮数
+    size_t CachedBytes() const;                           // 当前缓存的字节数
+    size_t AllocatedBytes() const { return _allocatedBytes; }
+    size_t FreedBytes() const { return _freedBytes; }
+
+    // 本线程的全部计数 (字节计数为实时值，其余为最近一次发布时的值)
+    // 顺带把字节计数发布出去，其他线程随后遍历时读到的就是这一刻的值
+    ThreadCounters Stats() {
+        PublishBytes();
+        return _stats->Read();
+    }
+
+    // ---------------------------------------------------------
+    // 字节计数 (快速路径)
+    // 只加本对象内的普通计数器 (与 _checkAt 同一个缓存行)，不经 _stats 指针写计数区；
+    // 计数区的值在慢速路径上 (PublishStats) 或本线程读取 Stats() 时才更新
+    // 配额检查与定期 Housekeeping 折算成与 _checkAt 的一次比较 (relaxed 原子读即普通读)
+    // ---------------------------------------------------------
+    void AccountAlloc(size_t bytes) {
+        _allocatedBytes += bytes;
+        if (_allocatedBytes >= _checkAt.load(std::memory_order_relaxed)) [[unlikely]] {
+            Housekeeping();
+        }
+    }
+
+    void AccountFree(size_t bytes) {
+        _freedBytes += bytes;
+    }
+
+    // 设置本线程的软配额；quotaBytes 为 0 或 callback 为空表示取消
+    void SetQuota(size_t quotaBytes, ThreadQuotaCallback callback, void* context);
+
+    // 把本线程缓存的对象全部还给 CentralCache，上限重新慢启动
+    void ReleaseAll();
+
+    // 基准对比用：关闭自适应，回到改造前的固定策略
+    // (溢出时归还 NumMoveSize 个、上限从不收缩、不做周期回收与预算裁剪)
+    void SetAdaptive(bool adaptive);
+
+    // 叫醒所有线程缓存：各线程下一次申请时 (快速路径也算) 执行一次 Housekeeping
+    // 链表只归所属线程读写，其他线程不能替它回收，只能让它自己尽快检查
+    static void WakeAll();
+
+    // 限速版 WakeAll：距上一次超过 SCAVENGE_PERIOD_MS 才叫醒
+    // 由活跃线程的 Scavenge 与 PressureMonitor 周期调用，让只走快速路径或长时间空闲的线程也按时间回收
+    static void WakeAllPeriodically();
+
+private:
+    // 响应全局冲刷请求 (慢速路径与 Housekeeping 上检查，一次原子读)
+    // 返回 true 表示刚刚冲刷过
+    bool CheckFlushEpoch() {
+        uint64_t epoch = g_threadCacheFlushEpoch.load(std::memory_order_relaxed);
+        if (epoch != _flushEpoch) [[unlikely]] {
+            _flushEpoch = epoch;
+            _flushes++;
+            ReleaseAll();
+            return true;
+        }
+        return false;
+    }
+
+    // 慢速路径计数，每 SCAVENGE_INTERVAL 次做一次空闲回收
+    void Tick() {
+        if (!CheckFlushEpoch() && _adaptive && ++_slowEvents >= SCAVENGE_INTERVAL) [[unlikely]] {
+            Scavenge();
+        }
+        PublishStats();
+    }
+
+    // 快速路径上累计申请越过 _checkAt 时调用 (每 HOUSEKEEPING_BYTES 一次，或被 WakeAll 叫醒)：
+    // 1. 响应冲刷请求，没有则按时间补做回收 (ScavengeByTime)
+    // 2. 配额检查
+    // 3. 重新设置下一次检查的位置
+    void Housekeeping();
+
+    // 距上一次 Scavenge 超过 SCAVENGE_PERIOD_MS 时补做回收
+    // 错过几个周期就做几轮 (最多 IDLE_SCAVENGE_ROUNDS)：闲置对象每轮减半，闲得越久还得越多
+    // 弹匣前端：错过两个周期以上时把弹匣里的对象也全部还回去
+    void ScavengeByTime();
+
+    // 下一次快速路径检查的位置：下一个 Housekeeping 点与配额检查点取小
+    // 与 RequestThreadCacheFlush 的 "纪元加一 -> WakeAll 清零" 配对 (都是 seq_cst)：
+    // 先写 _checkAt 再读纪元，要么这里读到新纪元，要么对方的清零排在这次写之后，冲刷请求不会丢
+    void ArmCheck() {
+        _checkAt.store(std::min(_allocatedBytes + HOUSEKEEPING_BYTES, _quotaCheckAt), std::memory_order_seq_cst);
+        if (g_threadCacheFlushEpoch.load(std::memory_order_seq_cst) != _flushEpoch) [[unlikely]] {
+            _checkAt.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    // 登记到全局线程缓存链表 (WakeAll 遍历)
+    void Register();
+    void Unregister();
+
+    // 把字节计数发布到本线程的计数区 (所属线程单写，relaxed store 即可)
+    void PublishBytes() {
+        _stats->_allocatedBytes.store(_allocatedBytes, std::memory_order_relaxed);
+        _stats->_freedBytes.store(_freedBytes, std::memory_order_relaxed);
+    }
+
+    // 把慢速路径计数与字节计数发布到本线程的计数区 (监控线程无锁读取)
+    void PublishStats() {
+        PublishBytes();
+        ThreadCounters counters;
+        counters.fetches = _fetchCount;
+        counters.fetchedObjects = _fetchedObjs;
+        counters.releases = _releaseCount;
+        counters.releasedObjects = _releasedObjs;
+        counters.budgetTrims = _budgetTrims;
+        counters.flushes = _flushes;
+        _stats->_counters.Write(counters);
+    }
+
+    // 净申请字节数可能越过配额时调用：超额则回调，并算出下一次需要检查的位置
+    void CheckQuota(size_t allocated);
+
+    // 周期性回收：
+    // 1. 归还整个周期都没用到的对象 (低水位的一半)
+    // 2. 整个周期只溢出或空闲、没有 miss 的链表，上限减半
+    // 3. 缓存仍超出 ThreadCacheBudget 时，各链表再归还一半，直到回到预算以内
+    // "周期"以先到者为准：SCAVENGE_INTERVAL 次慢速路径事件，或 SCAVENGE_PERIOD_MS (见 Housekeeping)
+    // 完全停止调用分配器的线程仍保持停下时的链表，直到它下一次申请
+    void Scavenge();
+
+    // 从链表头部剥离 n 个对象还给 CentralCache (按链表所属的 Span 池)
+    void ReleaseToCentral(FreeList& list, size_t n, size_t size);
+
+    // 把帧回收链表中的帧全部还给 CentralCache，槽位重新认领
+    void ReleaseFrames();
+
+    // 设置各链表的批量上限 (固定策略下归还批量取 MaxNum)
+    void InitLists(FreeList* lists, bool longLived) {
+        for (int i = 0; i < MAX_NFREELISTS; ++i) {
+            InitListBatch(lists[i], SizeUtils::Size(i));
+            if (!_adaptive) lists[i].SetTransferNum(lists[i].MaxNum());
+            lists[i].SetLongLived(longLived);
+        }
+    }
+
+    // 长寿命对象的本地链表，按需创建
+    struct LongLivedLists {
+        FreeList _lists[MAX_NFREELISTS];
+    };
+
+    static ObjectPool<LongLivedLists>& GetLongLivedPool() {
+        static ObjectPool<LongLivedLists> pool;
+        return pool;
+    }
+
+    FreeList& LongLivedList(size_t index) {
+        if (_longLived == nullptr) [[unlikely]] {
+            _longLived = GetLongLivedPool().New();
+            InitLists(_longLived->_lists, true);
+        }
+        return _longLived->_lists[index];
+    }
+
+    // 隔离对象的本地链表，按需创建 (下标为 SizeUtils::IsolatedIndex)
+    struct IsolatedLists {
+        FreeList _lists[ISOLATED_NCLASSES];
+    };
+
+    static ObjectPool<IsolatedLists>& GetIsolatedPool() {
+        static ObjectPool<IsolatedLists> pool;
+        return pool;
+    }
+
+    void InitIsolatedLists() {
+        for (size_t i = 0; i < ISOLATED_NCLASSES; ++i) {
+            FreeList& list = _isolated->_lists[i];
+            InitListBatch(list, SizeUtils::IsolatedClassSize(i));
+            if (!_adaptive) list.SetTransferNum(list.MaxNum());
+            list.SetIsolated(true);
+        }
+    }
+
+    FreeList& IsolatedList(size_t index) {
+        if (_isolated == nullptr) [[unlikely]] {
+            _isolated = GetIsolatedPool().New();
+            InitIsolatedLists();
+        }
+        return _isolated->_lists[index];
+    }
+
+    // 依次访问所有本地链表 (含长寿命链表与隔离链表)：fn(list, size)
+    template <typename Fn>
+    void ForEachList(Fn&& fn) {
+        for (int i = 0; i < MAX_NFREELISTS; ++i) fn(_freeLists[i], SizeUtils::Size(i));
+        if (_longLived) {
+            for (int i = 0; i < MAX_NFREELISTS; ++i) fn(_longLived->_lists[i], SizeUtils::Size(i));
+        }
+        if (_isolated) {
+            for (size_t i = 0; i < ISOLATED_NCLASSES; ++i) fn(_isolated->_lists[i], SizeUtils::IsolatedClassSize(i));
+        }
+    }
+
+#ifdef KZALLOC_USE_MAGAZINE
+    // 弹匣前端的慢速路径
+    // 采用 Bonwick 的双弹匣方案 (loaded + previous)：
+    // previous 永远是满的或空的，在满/空边界来回申请释放时只需交换两只弹匣
+    void* MagazineAllocSlow(size_t index, size_t size);
+    void MagazineFreeSlow(void* ptr, size_t index, size_t size);
+
+    // 从弹匣池取一只空弹匣，容量按规格设置 (见 MagazineCapacity)
+    static Magazine* NewMagazine(size_t index) {
+        Magazine* mag = GetMagazinePool().New();
+        mag->_capacity = MagazineCapacity(SizeUtils::Size(index));
+        return mag;
+    }
+
+    // 把弹匣里的对象全部还给 CentralCache，弹匣留着复用
+    void ReleaseMagazine(Magazine* mag, size_t size);
+#endif
+
 private:
+    uint64_t _flushEpoch = g_threadCacheFlushEpoch.load(std::memory_order_relaxed);
+    size_t _slowEvents = 0;
+    uint64_t _lastScavengeMs = NowMilliseconds();
+    bool _adaptive = true;
+    size_t _fetchCount = 0;
+    size_t _fetchedObjs = 0;
+    size_t _releaseCount = 0;
+    size_t _releasedObjs = 0;
+    size_t _budgetTrims = 0;
+    size_t _flushes = 0;
+    ThreadStatsBlock* _stats = ThreadStatsRegistry::GetInstance()->Acquire();
+
+    // 累计申请/释放字节数 (快速路径只写这里，见 AccountAlloc)
+    size_t _allocatedBytes = 0;
+    size_t _freedBytes = 0;
+
+    // 快速路径检查点：累计申请字节数到达它时执行 Housekeeping
+    // 只有所属线程前移它；WakeAll 从其他线程把它清零，让所属线程下一次申请就检查
+    std::atomic<size_t> _checkAt{HOUSEKEEPING_BYTES};
+
+    // 软配额：累计申请字节数到达 _quotaCheckAt 时才重新计算净值
+    size_t _quotaCheckAt = SIZE_MAX;
+    size_t _quotaBytes = 0;
+    ThreadQuotaCallback _quotaCallback = nullptr;
+    void* _quotaContext = nullptr;
+
     // 哈希桶，对应 SizeUtils 的映射规则
     FreeList _freeLists[MAX_NFREELISTS];
+    LongLivedLists* _longLived = nullptr;
+    IsolatedLists* _isolated = nullptr;
+
+    FrameSlot _frames[FRAME_SLOTS];
+
+#ifdef KZALLOC_USE_MAGAZINE
+    // 每个桶两只弹匣，首次使用该桶时才从弹匣池申请
+    Magazine* _loaded[MAX_NFREELISTS] = {};
+    Magazine* _previous[MAX_NFREELISTS] = {};
+#endif
+
+    // 全局线程缓存链表 (只在线程创建/退出与 WakeAll 时加锁)
+    ThreadCache* _prevCache = nullptr;
+    ThreadCache* _nextCache = nullptr;
+    static SpinMutex _cachesMtx;
+    static inline ThreadCache* _caches = nullptr;
+    static inline std::atomic<uint64_t> _lastWakeMs{0};
 };
 
+inline SpinMutex ThreadCache::_cachesMtx;
+
+// 请求所有线程冲刷本地缓存 (异步，各线程自行完成)
+// 纪元加一后叫醒所有线程缓存：只走快速路径的线程下一次申请就会冲刷；
+// 完全不调用分配器的线程要等到它下一次申请 (链表只归所属线程读写)
+// 弹匣前端的 Depot 是全局的，不等线程，这里直接倒空
+inline void RequestThreadCacheFlush() {
+    g_threadCacheFlushEpoch.fetch_add(1, std::memory_order_seq_cst);
+    ThreadCache::WakeAll();
+#ifdef KZALLOC_USE_MAGAZINE
+    CentralCache::GetInstance()->ReleaseMagazineDepots();
+#endif
+}
+
 // TLS 全局指针
 // static 保证只在当前编译单元可见（如果有多个cpp包含这个h可能会有问题，建议放cpp里定义，这里声明）
 // 为了头文件整洁，我们在 cpp 里定义 pTLSThreadCache
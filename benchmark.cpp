@@ -10,10 +10,25 @@
 #include <list>
 #include <mutex>
 #include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <coroutine>
+#include <exception>
+
+#ifndef _WIN32
+#include <sys/wait.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 // 引入内存池头文件
 #include "ConcurrentAlloc.h"
 #include "KzAllocator.h"
+#include "PressureMonitor.h"
+#include "StatsReporter.h"
+#include "BasicAllocator.h"
+#include "KzCoroutine.h"
 
 using namespace KzAlloc;
 
@@ -63,6 +78,102 @@ void TestLargeAlloc() {
     std::cout << "   Pass." << std::endl;
 }
 
+void TestAlignedAlloc() {
+    std::cout << "=> Running Aligned Allocation Test (natural alignment)..." << std::endl;
+    // 2 的幂规格：普通 malloc 得到的对象天然按自身大小对齐 (不超过页大小)
+    for (size_t size = 8; size <= PAGE_SIZE; size <<= 1) {
+        std::vector<void*> ptrs;
+        for (int i = 0; i < 64; ++i) {
+            ptrs.push_back(KzAlloc::malloc(size));
+            assert(((uintptr_t)ptrs.back() & (size - 1)) == 0);
+        }
+        for (void* p : ptrs) KzAlloc::free(p, size);
+    }
+
+    // aligned_alloc：任意大小 x 各级对齐
+    for (size_t align = 1; align <= PAGE_SIZE; align <<= 1) {
+        for (size_t size : {1, 24, 100, 1000, 3000, 5000, 70000, 300000}) {
+            void* p = KzAlloc::aligned_alloc(align, size);
+            assert(p && ((uintptr_t)p & (align - 1)) == 0);
+            std::memset(p, 0xab, size);
+            if (size % 2) KzAlloc::free(p);
+            else KzAlloc::free_aligned_sized(p, align, size);
+        }
+    }
+    assert(KzAlloc::aligned_alloc(3, 16) == nullptr);
+    assert(KzAlloc::aligned_alloc(2 * PAGE_SIZE, 16) == nullptr);
+    std::cout << "   Pass." << std::endl;
+}
+
+// 独立堆使用的策略 (测试与策略对比共用)
+struct SmallPagePolicy {
+    static constexpr size_t PAGE_SHIFT = 12;
+    static constexpr size_t MAX_BYTES = 32 * 1024;
+    static constexpr size_t RELEASE_BYTES = 1024 * 1024; // 阈值调小，让测试走到 madvise 归还
+    using Lock = SpinMutex;
+};
+struct MutexHeapPolicy {
+    static constexpr size_t PAGE_SHIFT = 13;
+    static constexpr size_t MAX_BYTES = 256 * 1024;
+    using Lock = std::mutex;
+};
+struct LargePagePolicy {
+    static constexpr size_t PAGE_SHIFT = 16;
+    static constexpr size_t MAX_BYTES = 1024 * 1024;
+    using Lock = SpinMutex;
+};
+
+// 独立堆：各种大小 (含超过 MAX_BYTES 与超过 128 页的) 申请释放，sized / 不带大小两种释放，跨线程释放
+template <class Policy>
+void TestBasicAllocatorOne() {
+    using Heap = BasicAllocator<Policy>;
+    Heap* heap = Heap::GetInstance();
+    const size_t sizes[] = {1, 8, 24, 100, 1000, 1500, 5000, 30000, 32 * 1024, 100000,
+                            300000, 1024 * 1024, 3 * 1024 * 1024, 9 * 1024 * 1024};
+    std::vector<std::pair<void*, size_t>> live;
+    for (int round = 0; round < 200; ++round) {
+        for (size_t size : sizes) {
+            void* p = heap->Allocate(size);
+            assert(p && heap->RoundUp(size) >= size);
+            std::memset(p, (int)(round & 0xff), size);
+            if (size > Policy::MAX_BYTES) assert(((uintptr_t)p & (Heap::HEAP_PAGE_SIZE - 1)) == 0);
+            live.push_back({p, size});
+        }
+        // 释放一半，让 Span 合并与复用都走到
+        for (size_t i = round % 2; i < live.size(); i += 2) {
+            if (live[i].first == nullptr) continue;
+            if (i % 3 == 0) heap->Deallocate(live[i].first);
+            else heap->Deallocate(live[i].first, live[i].second);
+            live[i].first = nullptr;
+        }
+    }
+
+    // 剩下的交给另一个线程释放
+    std::thread t([&]() {
+        for (auto& [p, size] : live) {
+            if (p) heap->Deallocate(p, size);
+        }
+    });
+    t.join();
+    heap->ReleaseThreadCache();
+}
+
+void TestBasicAllocator() {
+    std::cout << "=> Running BasicAllocator Test (independent heaps)..." << std::endl;
+    TestBasicAllocatorOne<DefaultHeapPolicy>();
+    TestBasicAllocatorOne<SmallPagePolicy>();
+    assert(BasicAllocator<SmallPagePolicy>::GetInstance()->GetStats().releasedBytes > 0);
+    TestBasicAllocatorOne<MutexHeapPolicy>();
+    TestBasicAllocatorOne<LargePagePolicy>();
+    // 不同策略的堆互不干扰：同一大小得到的地址各自对齐到自己的页
+    void* a = BasicAllocator<SmallPagePolicy>::GetInstance()->Allocate(64 * 1024);
+    void* b = BasicAllocator<LargePagePolicy>::GetInstance()->Allocate(64 * 1024);
+    assert(((uintptr_t)b & (64 * 1024 - 1)) == 0);
+    BasicAllocator<SmallPagePolicy>::GetInstance()->Deallocate(a);
+    BasicAllocator<LargePagePolicy>::GetInstance()->Deallocate(b);
+    std::cout << "   Pass." << std::endl;
+}
+
 // ============================================================================
 // 第二部分：STL 兼容性测试 (STL Adapter Tests)
 // ============================================================================
@@ -442,7 +553,1422 @@ public:
     }
 };
 
+// ============================================================================
+// Span 尾部浪费报告：对比旧经验公式与预计算的最优页数 (只看 1KB 以上的桶)
+// ============================================================================
+void SizeClassWasteReport() {
+    std::cout << "\n--------------------------------------------------" << std::endl;
+    std::cout << " Span tail waste per size-class band (old heuristic -> precomputed)" << std::endl;
+    std::cout << "--------------------------------------------------" << std::endl;
+
+    struct Band { size_t lo, hi; };
+    const Band bands[] = {{1024, 8 * 1024}, {8 * 1024, 64 * 1024}, {64 * 1024, BASE_MAX_BYTES},
+#ifdef KZALLOC_EXTENDED_CLASSES
+                          {BASE_MAX_BYTES, MAX_BYTES},
+#endif
+    };
+
+    for (const Band& band : bands) {
+        double oldSum = 0, newSum = 0;
+        double oldMax = 0, newMax = 0;
+        size_t classes = 0;
+        for (size_t i = 0; i < MAX_NFREELISTS; ++i) {
+            size_t size = SizeUtils::Size(i);
+            if (size <= band.lo || size > band.hi) continue;
+
+            // 旧公式：min(512, 256KB/size) 个对象所需的页数
+            size_t num = std::min<size_t>(512, std::max<size_t>(1, BATCH_BYTES / size));
+            size_t oldPages = std::max<size_t>(1, (num * size) >> PAGE_SHIFT);
+            double oldWaste = 100.0 * ((oldPages << PAGE_SHIFT) % size) / (oldPages << PAGE_SHIFT);
+
+            size_t newPages = SizeUtils::NumPages(i);
+            double newWaste = 100.0 * SizeUtils::SpanWaste(i) / (newPages << PAGE_SHIFT);
+
+            oldSum += oldWaste;
+            newSum += newWaste;
+            oldMax = std::max(oldMax, oldWaste);
+            newMax = std::max(newMax, newWaste);
+            classes++;
+        }
+        printf("   (%6zuB, %6zuB] %3zu classes: avg %5.2f%% -> %5.2f%%, max %5.2f%% -> %5.2f%%\n",
+               band.lo, band.hi, classes, oldSum / classes, newSum / classes, oldMax, newMax);
+    }
+}
+
+// ============================================================================
+// 自适应 ThreadCache：突发 -> 来回 -> 稳态 -> 空闲，观察各阶段的进货/归还次数与阶段结束时的缓存字节数
+// 同一负载分别用改造前的固定策略 (SetAdaptive(false)) 与自适应策略各跑一遍
+// 空闲阶段两个线程都不调用分配器，由主线程 WakeAll (实际运行中是其他线程的 Scavenge
+// 或 PressureMonitor 周期调用) 叫醒后，各自的下一次申请走快速路径也会按空闲时长回收
+// ============================================================================
+void AdaptiveThreadCacheBenchmark() {
+    std::cout << "\n--------------------------------------------------" << std::endl;
+    std::cout << " Adaptive ThreadCache: burst, cycles, steady state, idle" << std::endl;
+    std::cout << "--------------------------------------------------" << std::endl;
+
+    struct Phase {
+        size_t fetches, fetchedObjs, releases, cachedKB;
+    };
+    struct Run {
+        Phase burst, cycles, steady, idle;
+    };
+    std::atomic<int> ready{0};
+    std::atomic<bool> go{false};
+
+    auto worker = [&](bool adaptive, Run& run) {
+        ThreadCache* tc = tls_manager.Get();
+        tc->SetAdaptive(adaptive);
+        // 计数取本阶段的增量
+        Phase last{};
+        auto snap = [tc, &last]() {
+            Phase now{tc->FetchCount(), tc->FetchedObjects(), tc->ReleaseCount(), tc->CachedBytes() / 1024};
+            Phase delta{now.fetches - last.fetches, now.fetchedObjs - last.fetchedObjs, now.releases - last.releases,
+                        now.cachedKB};
+            last = now;
+            return delta;
+        };
+
+        // 1. 突发：每种规格一次性申请大量对象后全部释放
+        const size_t sizes[] = {16, 64, 256, 1024, 4096};
+        std::vector<void*> ptrs(100000);
+        for (size_t sz : sizes) {
+            for (auto& p : ptrs) p = KzAlloc::malloc(sz);
+            for (auto p : ptrs) KzAlloc::free(p, sz);
+        }
+        run.burst = snap();
+
+        // 2. 来回：同一批 400 个 4KB 对象反复申请、释放 (工作集大于一个批量)
+        for (int r = 0; r < 20000; ++r) {
+            for (size_t i = 0; i < 400; ++i) ptrs[i] = KzAlloc::malloc(4096);
+            for (size_t i = 0; i < 400; ++i) KzAlloc::free(ptrs[i], 4096);
+        }
+        run.cycles = snap();
+
+        // 3. 稳态：小工作集在多个规格上反复申请释放
+        std::mt19937 gen(42);
+        std::vector<std::pair<void*, size_t>> live;
+        live.reserve(256);
+        for (size_t i = 0; i < 4000000; ++i) {
+            if (live.size() < 256 && (live.empty() || gen() % 2 == 0)) {
+                size_t sz = 8 + (gen() % 64) * 32;
+                live.emplace_back(KzAlloc::malloc(sz), sz);
+            } else {
+                size_t idx = gen() % live.size();
+                KzAlloc::free(live[idx].first, live[idx].second);
+                live[idx] = live.back();
+                live.pop_back();
+            }
+        }
+        for (auto& p : live) KzAlloc::free(p.first, p.second);
+        run.steady = snap();
+
+        // 4. 空闲：等主线程叫醒后只做一次申请释放
+        ready.fetch_add(1);
+        while (!go.load()) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        KzAlloc::free(KzAlloc::malloc(16), 16);
+        run.idle = snap();
+    };
+
+    // 两个线程依次跑完前三个阶段 (避免突发阶段同时占用两份内存)，然后一起空闲
+    Run fixed{}, adaptive{};
+    std::thread t1(worker, false, std::ref(fixed));
+    while (ready.load() < 1) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    std::thread t2(worker, true, std::ref(adaptive));
+    while (ready.load() < 2) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    std::this_thread::sleep_for(std::chrono::milliseconds(2 * SCAVENGE_PERIOD_MS + 100));
+    ThreadCache::WakeAll();
+    go.store(true);
+    t1.join();
+    t2.join();
+
+    printf("   %-9s %-8s %8s %12s %9s %10s\n", "policy", "phase", "fetches", "fetched_objs", "releases", "cached");
+    for (auto& [name, run] : {std::pair<const char*, Run&>{"fixed", fixed}, {"adaptive", adaptive}}) {
+        for (auto& [phase, ph] : {std::pair<const char*, Phase&>{"burst", run.burst}, {"cycles", run.cycles},
+                                  {"steady", run.steady}, {"idle", run.idle}}) {
+            printf("   %-9s %-8s %8zu %12zu %9zu %7zu KB\n", name, phase, ph.fetches, ph.fetchedObjs, ph.releases,
+                   ph.cachedKB);
+        }
+    }
+}
+
+// ============================================================================
+// Span 边界抖动：反复取走并归还恰好一个 Span 的全部对象
+// 没有空 Span 缓存时每一轮都要 NewSpan + 切分 + ReleaseSpan
+// 每个规格先关闭缓存 (TTL = 0) 跑一遍作为对照，再打开缓存跑一遍
+// ============================================================================
+void SpanChurnBenchmark() {
+    std::cout << "\n--------------------------------------------------" << std::endl;
+    std::cout << " Span churn at the span boundary (CentralCache)" << std::endl;
+    std::cout << "--------------------------------------------------" << std::endl;
+
+    const size_t sizes[] = {1024, 16 * 1024, 64 * 1024};
+    const size_t rounds = 200000;
+    CentralCache* cc = CentralCache::GetInstance();
+
+    // 之前的测试留在桶里的半满 Span 会先被取走，本轮可能根本不触及 Span 边界：
+    // 把这些空闲对象先全部取出来占住，测完再还
+    tls_manager.Get()->ReleaseAll();
+    cc->ReleaseEmptySpans(true);
+
+    printf("   %-6s %-9s %-5s %8s %8s %8s %8s\n", "size", "objs/span", "cache", "ms", "carves", "hits",
+           "released");
+    for (size_t sz : sizes) {
+        size_t index = SizeUtils::Index(sz);
+        size_t objSize = SizeUtils::RoundUp(sz);
+        size_t perSpan = (SizeUtils::NumPages(index) << PAGE_SHIFT) / objSize;
+
+        CentralClassStats cls = cc->GetClassStats(index);
+        size_t spare = cls.carvedObjs - cls.inUseObjs;
+        void* parked = nullptr;
+        void* parkedEnd = nullptr;
+        if (spare) cc->FetchRangeObj(parked, parkedEnd, spare, objSize);
+
+        for (bool cached : {false, true}) {
+            cc->SetEmptySpanTtl(cached ? EMPTY_SPAN_TTL_MS : 0);
+            EmptySpanStats before = cc->GetEmptySpanStats();
+            auto start = std::chrono::high_resolution_clock::now();
+            for (size_t i = 0; i < rounds; ++i) {
+                void* first = nullptr;
+                void* last = nullptr;
+                size_t got = cc->FetchRangeObj(first, last, perSpan, objSize);
+                assert(got == perSpan);
+                (void)got;
+                cc->ReleaseListToSpans(first, objSize);
+            }
+            auto end = std::chrono::high_resolution_clock::now();
+            EmptySpanStats after = cc->GetEmptySpanStats();
+
+            printf("   %-6zu %-9zu %-5s %8lld %8zu %8zu %8zu\n", sz, perSpan, cached ? "on" : "off",
+                   (long long)std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count(),
+                   after.carves - before.carves, after.hits - before.hits, after.releases - before.releases);
+            if (cached) assert(after.hits - before.hits >= rounds - 1);
+        }
+
+        if (parked) cc->ReleaseListToSpans(parked, objSize);
+    }
+    cc->SetEmptySpanTtl(EMPTY_SPAN_TTL_MS);
+    cc->ReleaseEmptySpans(true);
+}
+
+// ============================================================================
+// 峰值后的碎片：大量申请后随机释放大部分，再以小工作集长时间运行，
+// 观察 PageHeap 中仍被占用的页数 (Span 挑选策略决定了稀疏 Span 能否被清空)
+// ============================================================================
+void FragmentationAfterPeakBenchmark() {
+    std::cout << "\n--------------------------------------------------" << std::endl;
+    std::cout << " Fragmentation after a traffic peak" << std::endl;
+    std::cout << "--------------------------------------------------" << std::endl;
+
+    std::thread t([]() {
+        const size_t sz = 64;
+        const size_t peak = 400000;
+        std::mt19937 gen(7);
+        // 其他测试留下的占用不算在内：只看本测试开始以来的增量
+        const size_t baseUsed = PageHeap::GetInstance()->GetReleaseStats().usedPages;
+        auto usedKB = [baseUsed]() {
+            long long pages = (long long)PageHeap::GetInstance()->GetReleaseStats().usedPages - (long long)baseUsed;
+            return pages * (long long)PAGE_SIZE / 1024;
+        };
+
+        // 1. 峰值
+        std::vector<void*> live(peak);
+        for (auto& p : live) p = KzAlloc::malloc(sz);
+        long long peakKB = usedKB();
+
+        // 2. 随机释放 90%
+        std::shuffle(live.begin(), live.end(), gen);
+        for (size_t i = peak / 10; i < peak; ++i) KzAlloc::free(live[i], sz);
+        live.resize(peak / 10);
+        long long afterFreeKB = usedKB();
+
+        // 3. 稳态：工作集不变，每轮随机释放四分之一再补回
+        // 批量足够大，超出 ThreadCache 的部分会真正回到 CentralCache
+        for (size_t round = 0; round < 200; ++round) {
+            std::shuffle(live.begin(), live.end(), gen);
+            size_t n = live.size() / 4;
+            for (size_t i = 0; i < n; ++i) KzAlloc::free(live[i], sz);
+            for (size_t i = 0; i < n; ++i) live[i] = KzAlloc::malloc(sz);
+        }
+        long long steadyKB = usedKB();
+
+        printf("   live=%zu KB  used pages delta: peak=%+lld KB  after_free=%+lld KB  after_steady=%+lld KB\n",
+               live.size() * sz / 1024, peakKB, afterFreeKB, steadyKB);
+
+        for (auto p : live) KzAlloc::free(p, sz);
+    });
+    t.join();
+}
+
+// ============================================================================
+// 跨分片偷取：线程依次申请并释放一批大块内存
+// 每个线程可能被路由到不同分片，后来的线程应当复用前面线程留下的空闲页
+// ============================================================================
+void CrossShardStealBenchmark() {
+    std::cout << "\n--------------------------------------------------" << std::endl;
+    std::cout << " Cross-shard stealing: sequential threads, 64 x 1MB each" << std::endl;
+    std::cout << "--------------------------------------------------" << std::endl;
+
+    const size_t sz = 1024 * 1024;
+    const size_t count = 64;
+    ReleaseStats before = PageHeap::GetInstance()->GetReleaseStats();
+
+    // 线程同时存活 (线程 ID 不会被复用，从而路由到不同分片)，但按顺序轮流工作
+    const int n_threads = 8;
+    std::atomic<int> turn{0};
+    std::vector<std::thread> threads;
+    for (int i = 0; i < n_threads; ++i) {
+        threads.emplace_back([&, i]() {
+            while (turn.load(std::memory_order_acquire) != i) std::this_thread::yield();
+            std::vector<void*> ptrs(count);
+            for (auto& p : ptrs) p = KzAlloc::malloc(sz);
+            for (auto p : ptrs) KzAlloc::free(p, sz);
+            turn.store(i + 1, std::memory_order_release);
+        });
+    }
+    for (auto& t : threads) t.join();
+
+    ReleaseStats after = PageHeap::GetInstance()->GetReleaseStats();
+    // 空闲页数取本测试前后的变化，不含其他测试留下的缓存
+    long long cachedPages = (long long)after.freePages - (long long)before.freePages;
+    printf("   stolen_spans=%zu stolen_pages=%zu cached_delta=%+lld KB\n",
+           after.stolenSpans - before.stolenSpans,
+           after.stolenPages - before.stolenPages,
+           cachedPages * (long long)PAGE_SIZE / 1024);
+}
+
+// ============================================================================
+// 大块内存交接流水线：生产者申请、消费者释放
+// 消费者归还的 Span 属于生产者的分片，释放路径不应阻塞在对方的分片锁上
+// ============================================================================
+void LargeHandoffBenchmark() {
+    std::cout << "\n--------------------------------------------------" << std::endl;
+    std::cout << " Large buffer handoff: 4 producer/consumer pairs, 512KB" << std::endl;
+    std::cout << "--------------------------------------------------" << std::endl;
+
+    const size_t sz = 512 * 1024;
+    const size_t per_pair = 50000;
+    const size_t batch = 32;
+    const int pairs = 4;
+
+    struct Channel {
+        std::mutex mtx;
+        std::vector<void*> items;
+        bool done = false;
+    };
+    std::vector<Channel> channels(pairs);
+
+    ReleaseStats before = PageHeap::GetInstance()->GetReleaseStats();
+    auto start = std::chrono::high_resolution_clock::now();
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < pairs; ++p) {
+        Channel& ch = channels[p];
+        threads.emplace_back([&ch, sz, per_pair, batch]() {
+            std::vector<void*> local;
+            local.reserve(batch);
+            for (size_t i = 0; i < per_pair; ++i) {
+                void* ptr = KzAlloc::malloc(sz);
+                *(volatile char*)ptr = 1;
+                local.push_back(ptr);
+                if (local.size() == batch) {
+                    // 背压：对方积压太多时等一等，避免工作集无限增长
+                    while (true) {
+                        {
+                            std::lock_guard<std::mutex> lock(ch.mtx);
+                            if (ch.items.size() < batch * 4) {
+                                ch.items.insert(ch.items.end(), local.begin(), local.end());
+                                break;
+                            }
+                        }
+                        std::this_thread::yield();
+                    }
+                    local.clear();
+                }
+            }
+            std::lock_guard<std::mutex> lock(ch.mtx);
+            ch.items.insert(ch.items.end(), local.begin(), local.end());
+            ch.done = true;
+        });
+        threads.emplace_back([&ch, sz]() {
+            std::vector<void*> local;
+            while (true) {
+                bool done;
+                {
+                    std::lock_guard<std::mutex> lock(ch.mtx);
+                    local.swap(ch.items);
+                    done = ch.done;
+                }
+                if (local.empty()) {
+                    if (done) break;
+                    std::this_thread::yield();
+                    continue;
+                }
+                for (void* ptr : local) KzAlloc::free(ptr, sz);
+                local.clear();
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+
+    auto end = std::chrono::high_resolution_clock::now();
+    ReleaseStats after = PageHeap::GetInstance()->GetReleaseStats();
+    printf("   %lld ms  deferred_returns=%zu\n",
+           (long long)std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count(),
+           after.deferredReturns - before.deferredReturns);
+}
+
+// ============================================================================
+// PageHeap 小 Span 反复申请释放：延迟合并省掉每次归还时的合并与再次切分
+// 1024 个 1~8 页的 Span 随机替换：快速链表会攒满 QUICK_LIST_CAP_PAGES 而批量合并，
+// 也会在大小对不上时因缺货而合并，两条 flush 路径都会走到
+// 先关闭快速链表跑一遍作为对照，比较分片锁的平均持有时间 (周期数)
+// ============================================================================
+void SmallSpanChurnBenchmark() {
+    std::cout << "\n--------------------------------------------------" << std::endl;
+    std::cout << " PageHeap small span churn (1~8 pages)" << std::endl;
+    std::cout << "--------------------------------------------------" << std::endl;
+
+    PageHeap* ph = PageHeap::GetInstance();
+    for (bool quick : {false, true}) {
+        std::thread t([ph, quick]() {
+            ph->SetQuickLists(quick);
+            ReleaseStats before = ph->GetReleaseStats();
+            std::mt19937 gen(3);
+            std::vector<Span*> live(1024, nullptr);
+            const size_t ops = 2000000;
+
+            auto start = std::chrono::high_resolution_clock::now();
+            for (size_t i = 0; i < ops; ++i) {
+                Span*& slot = live[gen() % live.size()];
+                if (slot) ph->ReleaseSpan(slot);
+                slot = ph->NewSpan(1 + gen() % 8);
+            }
+            auto end = std::chrono::high_resolution_clock::now();
+            for (Span*& span : live) {
+                ph->ReleaseSpan(span);
+                span = nullptr;
+            }
+
+            ReleaseStats after = ph->GetReleaseStats();
+            size_t acquires = after.lockAcquires - before.lockAcquires;
+            printf("   quick lists %-3s %6.1f ns/op  lock hold %5.0f cycles/acquire  quick_flushes=%zu\n",
+                   quick ? "on" : "off", std::chrono::duration<double, std::nano>(end - start).count() / ops,
+                   acquires ? (double)(after.lockHoldCycles - before.lockHoldCycles) / acquires : 0.0,
+                   after.quickFlushes - before.quickFlushes);
+            if (quick) assert(after.quickFlushes > before.quickFlushes);
+        });
+        t.join();
+    }
+    ph->SetQuickLists(true);
+}
+
+// ============================================================================
+// 驻留统计：一半 Span 先归还给 OS，另一半随后释放并与之合并成冷热混合的 Span
+// 驻留位图保证再次回收时只 madvise 驻留页，重新分配时 refaulted 等于实际缺页数
+// ============================================================================
+void ResidencyAccountingReport() {
+    std::cout << "\n--------------------------------------------------" << std::endl;
+    std::cout << " Residency accounting: 3 cycles of 256 x 512KB" << std::endl;
+    std::cout << "--------------------------------------------------" << std::endl;
+
+    std::thread t([]() {
+        const size_t sz = 512 * 1024;
+        std::vector<void*> ptrs(256);
+        PageHeap* ph = PageHeap::GetInstance();
+        for (int cycle = 0; cycle < 3; ++cycle) {
+            ReleaseStats before = ph->GetReleaseStats();
+            for (auto& p : ptrs) p = KzAlloc::malloc(sz);
+            ReleaseStats afterAlloc = ph->GetReleaseStats();
+
+            // 隔一个释放一个并全部归还，再释放剩下的：后一半与冷邻居合并
+            for (size_t i = 0; i < ptrs.size(); i += 2) KzAlloc::free(ptrs[i], sz);
+            ph->ReleaseFreeMemory();
+            for (size_t i = 1; i < ptrs.size(); i += 2) KzAlloc::free(ptrs[i], sz);
+            ph->ReleaseFreeMemory();
+
+            ReleaseStats after = ph->GetReleaseStats();
+            printf("   cycle %d: refaulted=%zu released=%zu hot_cached=%zu pages\n", cycle,
+                   afterAlloc.refaultedPages - before.refaultedPages,
+                   after.releasedPages - afterAlloc.releasedPages,
+                   after.freePages);
+        }
+    });
+    t.join();
+}
+
+// ============================================================================
+// 批量 madvise：释放大量互不相邻的 1 页 Span 后全部归还，观察系统调用次数
+// ============================================================================
+void MadviseBatchReport() {
+    std::cout << "\n--------------------------------------------------" << std::endl;
+    std::cout << " Batched madvise: release 2048 scattered 1-page spans" << std::endl;
+    std::cout << "--------------------------------------------------" << std::endl;
+
+    std::thread t([]() {
+        PageHeap* ph = PageHeap::GetInstance();
+        std::vector<Span*> spans(4096);
+        for (auto& span : spans) span = ph->NewSpan(1);
+        // 隔一个释放一个，留下的 Span 把空闲页隔开，无法合并
+        for (size_t i = 0; i < spans.size(); i += 2) ph->ReleaseSpan(spans[i]);
+
+        ReleaseStats before = ph->GetReleaseStats();
+        auto start = std::chrono::high_resolution_clock::now();
+        ph->ReleaseFreeMemory();
+        auto end = std::chrono::high_resolution_clock::now();
+        ReleaseStats after = ph->GetReleaseStats();
+
+        printf("   released=%zu pages  syscalls=%zu  %lld us\n",
+               after.releasedPages - before.releasedPages,
+               after.madviseCalls - before.madviseCalls,
+               (long long)std::chrono::duration_cast<std::chrono::microseconds>(end - start).count());
+
+        for (size_t i = 1; i < spans.size(); i += 2) ph->ReleaseSpan(spans[i]);
+    });
+    t.join();
+}
+
+// ============================================================================
+// 预缺页：反复复用被归还过的 512KB 冷 Span，分别统计分配耗时与首次写满耗时
+// ============================================================================
+void PopulateWriteBenchmark() {
+    std::cout << "\n--------------------------------------------------" << std::endl;
+    std::cout << " Reused cold 512KB spans: MADV_POPULATE_WRITE" << std::endl;
+    std::cout << "--------------------------------------------------" << std::endl;
+
+    std::thread t([]() {
+        const size_t sz = 512 * 1024;
+        const int rounds = 500;
+        PageHeap* ph = PageHeap::GetInstance();
+        const char* names[] = {"off  ", "sync "};
+
+        for (int mode = 0; mode < 2; ++mode) {
+            ph->SetPopulateThreshold(mode == 0 ? 0 : 32);
+            double allocUs = 0, writeUs = 0;
+            for (int r = 0; r < rounds; ++r) {
+                ph->ReleaseFreeMemory(); // 让下一次分配拿到的是冷 Span
+
+                auto t0 = std::chrono::high_resolution_clock::now();
+                char* p = (char*)KzAlloc::malloc(sz);
+                auto t1 = std::chrono::high_resolution_clock::now();
+                for (size_t off = 0; off < sz; off += 4096) p[off] = (char)off;
+                auto t2 = std::chrono::high_resolution_clock::now();
+
+                allocUs += std::chrono::duration<double, std::micro>(t1 - t0).count();
+                writeUs += std::chrono::duration<double, std::micro>(t2 - t1).count();
+                KzAlloc::free(p, sz);
+            }
+            printf("   %s alloc=%.1f us  first-write=%.1f us (avg per buffer)\n",
+                   names[mode], allocUs / rounds, writeUs / rounds);
+        }
+        ph->SetPopulateThreshold(0);
+        printf("   populated_pages=%zu\n", ph->GetReleaseStats().populatedPages);
+    });
+    t.join();
+}
+
+
+// 监控线程高频轮询统计：无锁快照 vs 加锁汇总，对分配线程的影响
+void StatsSnapshotBenchmark() {
+    std::cout << "\n--------------------------------------------------" << std::endl;
+    std::cout << " Stats polling: seqlock snapshot vs locked walk" << std::endl;
+    std::cout << "--------------------------------------------------" << std::endl;
+
+    const int nthreads = 4;
+    const int ops = 200000;
+    const char* names[] = {"no poller    ", "GetStats     ", "locked stats "};
+
+    for (int mode = 0; mode < 3; ++mode) {
+        std::atomic<bool> running{true};
+        std::atomic<size_t> polls{0};
+        std::thread poller([&]() {
+            if (mode == 0) return;
+            while (running.load(std::memory_order_relaxed)) {
+                if (mode == 1) {
+                    AllocatorStats st = KzAlloc::GetStats();
+                    assert(st.threads.fetchedObjects >= st.threads.fetches);
+                    (void)st;
+                } else {
+                    ReleaseStats st = PageHeap::GetInstance()->GetReleaseStats();
+                    (void)st;
+                }
+                polls.fetch_add(1, std::memory_order_relaxed);
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+            }
+        });
+
+        auto t0 = std::chrono::high_resolution_clock::now();
+        std::vector<std::thread> workers;
+        for (int t = 0; t < nthreads; ++t) {
+            workers.emplace_back([t, ops]() {
+                std::mt19937 rng(t);
+                std::vector<void*> live(512, nullptr);
+                for (int i = 0; i < ops; ++i) {
+                    size_t slot = rng() % live.size();
+                    if (live[slot]) KzAlloc::free(live[slot]);
+                    // 混入大对象，让分片锁也被频繁使用
+                    size_t sz = (i % 64 == 0) ? 300 * 1024 : 16 + rng() % 4096;
+                    live[slot] = KzAlloc::malloc(sz);
+                }
+                for (void* p : live) KzAlloc::free(p);
+            });
+        }
+        for (auto& w : workers) w.join();
+        auto t1 = std::chrono::high_resolution_clock::now();
+        running = false;
+        poller.join();
+
+        double ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+        printf("   %s %8.1f ms  polls=%zu\n", names[mode], ms, polls.load());
+    }
+
+    AllocatorStats st = KzAlloc::GetStats();
+    printf("   totals: fetches=%zu fetched=%zu releases=%zu released=%zu live_threads=%zu used_pages=%zu\n",
+           st.threads.fetches, st.threads.fetchedObjects, st.threads.releases,
+           st.threads.releasedObjects, st.liveThreads, st.pages.usedPages);
+}
+
+// 线程级字节计数：各线程按已知模式申请，主线程遍历注册表核对；再演示软配额回调
+void ThreadAccountingReport() {
+    std::cout << "\n--------------------------------------------------" << std::endl;
+    std::cout << " Per-thread byte accounting & soft quota" << std::endl;
+    std::cout << "--------------------------------------------------" << std::endl;
+
+    // 1. 三个线程各自持有不同的量，停住等主线程遍历
+    const size_t sizes[] = {64, 1024, 512 * 1024};
+    const size_t counts[] = {20000, 2000, 8};
+    const int nthreads = 3;
+    std::atomic<int> ready{0};
+    std::atomic<bool> walked{false};
+    std::atomic<uint64_t> tids[nthreads];
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < nthreads; ++t) {
+        workers.emplace_back([&, t]() {
+            ThreadCounters before = KzAlloc::ThreadStats();
+            std::vector<void*> ptrs;
+            for (size_t i = 0; i < counts[t]; ++i) ptrs.push_back(KzAlloc::malloc(sizes[t]));
+            // 一半用 sized free，一半用普通 free
+            for (size_t i = 0; i < counts[t] / 2; ++i) {
+                if (i % 2) KzAlloc::free(ptrs[i], sizes[t]);
+                else KzAlloc::free(ptrs[i]);
+            }
+            ThreadCounters after = KzAlloc::ThreadStats();
+            assert(after.allocatedBytes - before.allocatedBytes == counts[t] * sizes[t]);
+            assert(after.freedBytes - before.freedBytes == counts[t] / 2 * sizes[t]);
+            (void)before;
+            (void)after;
+
+            tids[t].store(CurrentThreadId());
+            ready.fetch_add(1);
+            while (!walked.load()) std::this_thread::yield();
+            for (size_t i = counts[t] / 2; i < counts[t]; ++i) KzAlloc::free(ptrs[i]);
+        });
+    }
+    while (ready.load() < nthreads) std::this_thread::yield();
+
+    printf("   %-10s %14s %14s %14s\n", "tid", "allocated", "freed", "live");
+    size_t seen = 0;
+    KzAlloc::ForEachThreadStats([&](uint64_t tid, const ThreadCounters& c) {
+        for (int t = 0; t < nthreads; ++t) {
+            if (tids[t].load() != tid) continue;
+            printf("   %-10llu %14zu %14zu %14zu\n", (unsigned long long)tid, c.allocatedBytes, c.freedBytes,
+                   c.allocatedBytes - c.freedBytes);
+            assert(c.allocatedBytes - c.freedBytes == (counts[t] - counts[t] / 2) * sizes[t]);
+            ++seen;
+        }
+    });
+    assert(seen == (size_t)nthreads);
+    walked = true;
+    for (auto& w : workers) w.join();
+
+    // 2. 软配额：净申请超过 1MB 时回调，超额期间每再净增 256KB 提醒一次
+    struct QuotaLog {
+        size_t calls = 0;
+        size_t maxLive = 0;
+    } log;
+    std::thread([&]() {
+        KzAlloc::SetThreadQuota(1024 * 1024, [](size_t live, size_t, void* ctx) {
+            QuotaLog* l = static_cast<QuotaLog*>(ctx);
+            l->calls++;
+            if (live > l->maxLive) l->maxLive = live;
+        }, &log);
+
+        // 先在配额以内反复申请释放 (不应回调)，再持续净增到 4MB
+        for (int round = 0; round < 64; ++round) {
+            std::vector<void*> ptrs;
+            for (int i = 0; i < 128; ++i) ptrs.push_back(KzAlloc::malloc(4096));
+            for (void* p : ptrs) KzAlloc::free(p);
+        }
+        assert(log.calls == 0);
+        std::vector<void*> ptrs;
+        for (int i = 0; i < 1024; ++i) ptrs.push_back(KzAlloc::malloc(4096));
+        for (void* p : ptrs) KzAlloc::free(p);
+        KzAlloc::SetThreadQuota(0, nullptr);
+    }).join();
+    printf("   quota 1MB: %zu callbacks, max live seen %zu KB\n", log.calls, log.maxLive / 1024);
+    // 越过 1MB 一次，之后每 256KB 一次：(4MB - 1MB) / 256KB + 1
+    assert(log.calls >= 12 && log.calls <= 14 && log.maxLive > 1024 * 1024);
+
+    // 3. 计数开销：单线程 64B 申请释放
+    const int ops = 2000000;
+    auto t0 = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < ops; ++i) {
+        void* p = KzAlloc::malloc(64);
+        KzAlloc::free(p, 64);
+    }
+    auto t1 = std::chrono::high_resolution_clock::now();
+    printf("   malloc+free(64) with accounting: %.2f ns/pair\n",
+           std::chrono::duration<double, std::nano>(t1 - t0).count() / ops);
+}
+
+// 伪共享：每个线程一个 8 字节计数器，分别用 malloc 与 malloc_isolated 申请后各自累加
+// 普通规格下几个计数器紧挨着切分，落在同一缓存行里，每次累加都让其他核心的副本失效
+// 只有一个硬件线程时各线程轮流运行，缓存行不会在核心间来回传递，只检查布局不计时
+void FalseSharingBenchmark() {
+    std::cout << "\n--------------------------------------------------" << std::endl;
+    std::cout << " False sharing: per-thread counters, malloc vs malloc_isolated" << std::endl;
+    std::cout << "--------------------------------------------------" << std::endl;
+
+    using Counter = std::atomic<uint64_t>;
+    const unsigned cores = std::thread::hardware_concurrency();
+    const int nthreads = 4;
+    const size_t iters = 5000000;
+    auto sameBlock = [](const void* a, const void* b) {
+        return (uintptr_t)a / KZALLOC_ISOLATION_BYTES == (uintptr_t)b / KZALLOC_ISOLATION_BYTES;
+    };
+    [[maybe_unused]] auto spanOf = [](const void* p) { return PageMap::GetInstance()->get((PAGE_ID)p >> PAGE_SHIFT); };
+    if (cores < 2) {
+        printf("   hardware threads: %u -- false sharing needs at least 2 cores, timing skipped (layout only)\n",
+               cores);
+    }
+
+    double ms[2] = {0, 0};
+    for (int isolated = 0; isolated < 2; ++isolated) {
+        Counter* counters[nthreads];
+        for (auto& c : counters) {
+            void* p = isolated ? KzAlloc::malloc_isolated(sizeof(Counter)) : KzAlloc::malloc(sizeof(Counter));
+            c = new (p) Counter(0);
+        }
+
+        size_t sharedPairs = 0;
+        for (int i = 0; i < nthreads; ++i) {
+            for (int j = i + 1; j < nthreads; ++j) sharedPairs += sameBlock(counters[i], counters[j]);
+        }
+        if (isolated) {
+            // 专用隔离规格：来自隔离 Span 池，按粒度步长切分
+            for ([[maybe_unused]] Counter* c : counters) {
+                assert((uintptr_t)c % KZALLOC_ISOLATION_BYTES == 0);
+                assert(spanOf(c)->_isolated && spanOf(c)->_objSize == KZALLOC_ISOLATION_BYTES);
+            }
+            assert(sharedPairs == 0);
+        }
+
+        [[maybe_unused]] size_t expect = 0;
+        if (cores >= 2) {
+            auto t0 = std::chrono::high_resolution_clock::now();
+            std::vector<std::thread> workers;
+            for (int t = 0; t < nthreads; ++t) {
+                workers.emplace_back([c = counters[t], iters]() {
+                    for (size_t i = 0; i < iters; ++i) c->fetch_add(1, std::memory_order_relaxed);
+                });
+            }
+            for (auto& w : workers) w.join();
+            auto t1 = std::chrono::high_resolution_clock::now();
+            ms[isolated] = std::chrono::duration<double, std::milli>(t1 - t0).count();
+            expect = iters;
+            printf("   %-16s %8.1f ms  counter pairs sharing a %dB block: %zu\n",
+                   isolated ? "malloc_isolated" : "malloc", ms[isolated], KZALLOC_ISOLATION_BYTES, sharedPairs);
+        } else {
+            printf("   %-16s counter pairs sharing a %dB block: %zu\n",
+                   isolated ? "malloc_isolated" : "malloc", KZALLOC_ISOLATION_BYTES, sharedPairs);
+        }
+
+        for (Counter* c : counters) {
+            assert(c->load() == expect);
+            c->~Counter();
+            if (isolated) KzAlloc::free_isolated(c, sizeof(Counter));
+            else KzAlloc::free(c);
+        }
+    }
+
+    if (cores >= 2) {
+        printf("   speedup from isolation: %.2fx on %u hardware threads\n", ms[0] / ms[1], cores);
+    }
+
+    // 每个专用规格：块大小恰好是粒度的整数倍，不超过 ISOLATED_MAX_BYTES 的都不与普通申请共享 Span；
+    // 更大的退回普通规格，仍按粒度对齐。free 与 realloc 不带大小也能找回隔离池
+    for (size_t size : {size_t(1), size_t(KZALLOC_ISOLATION_BYTES + 1), ISOLATED_MAX_BYTES, ISOLATED_MAX_BYTES + 1}) {
+        void* a = KzAlloc::malloc_isolated(size);
+        void* b = KzAlloc::malloc_isolated(size);
+        assert((uintptr_t)a % KZALLOC_ISOLATION_BYTES == 0 && (uintptr_t)b % KZALLOC_ISOLATION_BYTES == 0);
+        assert(spanOf(a)->_isolated == (size <= ISOLATED_MAX_BYTES));
+        if (size <= ISOLATED_MAX_BYTES) assert(spanOf(a)->_objSize == SizeUtils::IsolatedClassSize(SizeUtils::IsolatedIndex(size)));
+        std::memset(a, 0x5a, size);
+        a = KzAlloc::realloc(a, size + ISOLATED_MAX_BYTES);
+        assert(((unsigned char*)a)[size - 1] == 0x5a);
+        KzAlloc::free(a);
+        KzAlloc::free(b);
+    }
+
+    // KzIsolatedAllocator：list 的每个节点单独隔离
+    std::list<uint64_t, KzIsolatedAllocator<uint64_t>> nodes;
+    for (int i = 0; i < 64; ++i) nodes.push_back(i);
+    [[maybe_unused]] const uint64_t* prev = nullptr;
+    for (const uint64_t& v : nodes) {
+        assert(prev == nullptr || !sameBlock(prev, &v));
+        prev = &v;
+    }
+}
+
+// 对齐申请：aligned_alloc 直接走普通快速路径，对比"多申请 alignment-1 再手动对齐"的常见做法
+void AlignedAllocBenchmark() {
+    std::cout << "\n--------------------------------------------------" << std::endl;
+    std::cout << " Aligned allocation: natural alignment vs over-allocate" << std::endl;
+    std::cout << "--------------------------------------------------" << std::endl;
+
+    const size_t ops = 2000000;
+    const size_t live = 1024;
+    std::vector<void*> ptrs(live);
+    struct Case {
+        size_t align;
+        size_t size;
+    } cases[] = {{64, 48}, {256, 200}, {4096, 4096}};
+
+    for (const Case& c : cases) {
+        // 1. aligned_alloc
+        auto t0 = std::chrono::high_resolution_clock::now();
+        for (size_t i = 0; i < ops; i += live) {
+            for (auto& p : ptrs) p = KzAlloc::aligned_alloc(c.align, c.size);
+            for (auto p : ptrs) KzAlloc::free_aligned_sized(p, c.align, c.size);
+        }
+        auto t1 = std::chrono::high_resolution_clock::now();
+
+        // 2. 多申请 align - 1 字节，手动对齐 (释放时需要原始指针)
+        std::vector<void*> raw(live);
+        size_t padded = c.size + c.align - 1;
+        for (size_t i = 0; i < ops; i += live) {
+            for (size_t j = 0; j < live; ++j) {
+                raw[j] = KzAlloc::malloc(padded);
+                ptrs[j] = (void*)(((uintptr_t)raw[j] + c.align - 1) & ~(uintptr_t)(c.align - 1));
+            }
+            for (auto p : raw) KzAlloc::free(p, padded);
+        }
+        auto t2 = std::chrono::high_resolution_clock::now();
+
+        printf("   align=%-5zu size=%-5zu aligned_alloc %6.2f ns (%5zu B/obj)  over-allocate %6.2f ns (%5zu B/obj)\n",
+               c.align, c.size, std::chrono::duration<double, std::nano>(t1 - t0).count() / ops,
+               SizeUtils::RoundUp(SizeUtils::AlignedSize(c.align, c.size)),
+               std::chrono::duration<double, std::nano>(t2 - t1).count() / ops, SizeUtils::RoundUp(padded));
+    }
+}
+
+// 独立堆的策略对比：页大小 x 规格上限 x 锁类型，同一组混合负载
+// 小对象 (16B ~ 1KB) 与中等对象 (1KB ~ 32KB) 各跑单线程和 4 线程，全局堆作为参照
+template <class Alloc, class Free>
+double PolicyWorkload(int n_threads, size_t max_size, Alloc&& alloc, Free&& release) {
+    const size_t ops = 400000;
+    const size_t live = 512;
+    auto start = std::chrono::high_resolution_clock::now();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < n_threads; ++t) {
+        threads.emplace_back([&, t]() {
+            std::mt19937 rng(1234 + t);
+            std::uniform_int_distribution<size_t> dist(max_size / 64, max_size);
+            std::vector<std::pair<void*, size_t>> slots(live, {nullptr, 0});
+            for (size_t i = 0; i < ops; ++i) {
+                auto& slot = slots[rng() % live];
+                if (slot.first) release(slot.first, slot.second);
+                slot.second = dist(rng);
+                slot.first = alloc(slot.second);
+                *(volatile char*)slot.first = 1;
+            }
+            for (auto& slot : slots) {
+                if (slot.first) release(slot.first, slot.second);
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / (ops * n_threads);
+}
+
+template <class Policy>
+void PolicyMatrixRow(const char* name) {
+    using Heap = BasicAllocator<Policy>;
+    Heap* heap = Heap::GetInstance();
+    auto alloc = [heap](size_t size) { return heap->Allocate(size); };
+    auto release = [heap](void* p, size_t size) { heap->Deallocate(p, size); };
+    BasicHeapStats before = heap->GetStats();
+    double r[4];
+    int k = 0;
+    for (size_t max_size : {1024, 32 * 1024}) {
+        for (int n : {1, 4}) r[k++] = PolicyWorkload(n, max_size, alloc, release);
+    }
+    BasicHeapStats after = heap->GetStats();
+    printf("   %-22s %7.1f %7.1f %7.1f %7.1f   %6zuKB  %6zuKB  %8zu\n", name, r[0], r[1], r[2], r[3],
+           after.systemBytes / 1024, after.releasedBytes / 1024, after.lockContended - before.lockContended);
+}
+
+void BasicAllocatorPolicyMatrix() {
+    std::cout << "\n--------------------------------------------------" << std::endl;
+    std::cout << " BasicAllocator policy matrix (ns/op)" << std::endl;
+    std::cout << "--------------------------------------------------" << std::endl;
+    printf("   %-22s %7s %7s %7s %7s   %8s  %8s  %8s\n", "policy", "1K x1", "1K x4", "32K x1", "32K x4",
+           "system", "released", "contended");
+
+    auto alloc = [](size_t size) { return KzAlloc::malloc(size); };
+    auto release = [](void* p, size_t size) { KzAlloc::free(p, size); };
+    double r[4];
+    int k = 0;
+    for (size_t max_size : {1024, 32 * 1024}) {
+        for (int n : {1, 4}) r[k++] = PolicyWorkload(n, max_size, alloc, release);
+    }
+    printf("   %-22s %7.1f %7.1f %7.1f %7.1f\n", "global KzAlloc::malloc", r[0], r[1], r[2], r[3]);
+
+    PolicyMatrixRow<SmallPagePolicy>("4KB page, 32KB, spin");
+    PolicyMatrixRow<DefaultHeapPolicy>("8KB page, 256KB, spin");
+    PolicyMatrixRow<MutexHeapPolicy>("8KB page, 256KB, mutex");
+    PolicyMatrixRow<LargePagePolicy>("64KB page, 1MB, spin");
+}
+
+// 协程帧：每个"请求"是一个协程，挂起 steps 次后结束，由调用方 destroy
+// Base 为空结构体时帧走全局 operator new，为 KzPromiseAllocator 时走 ThreadCache 与帧回收链表
+template <class Base>
+struct BenchCoroutine {
+    struct promise_type : Base {
+        BenchCoroutine get_return_object() {
+            return {std::coroutine_handle<promise_type>::from_promise(*this)};
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+    std::coroutine_handle<promise_type> handle;
+};
+
+struct DefaultFrameAllocator {};
+
+template <class Base>
+BenchCoroutine<Base> BenchRequest(size_t* counter, int steps) {
+    char scratch[96]; // 模拟请求处理时跨挂起点存活的局部状态
+    for (int i = 0; i < steps; ++i) {
+        scratch[i % sizeof(scratch)] = (char)i;
+        *counter += 1;
+        co_await std::suspend_always{};
+    }
+    *counter += (size_t)scratch[0];
+}
+
+// 每批 live 个协程同时在途：全部创建，轮流 resume 直到结束，再全部 destroy
+template <class Base>
+double CoroutineWorkload(int n_threads, size_t per_thread) {
+    const size_t live = 256;
+    const int steps = 3;
+    auto start = std::chrono::high_resolution_clock::now();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < n_threads; ++t) {
+        threads.emplace_back([per_thread, steps]() {
+            std::vector<std::coroutine_handle<typename BenchCoroutine<Base>::promise_type>> batch(live);
+            size_t counter = 0;
+            for (size_t done = 0; done < per_thread; done += live) {
+                for (auto& h : batch) h = BenchRequest<Base>(&counter, steps).handle;
+                for (int s = 0; s <= steps; ++s) {
+                    for (auto& h : batch) h.resume();
+                }
+                for (auto& h : batch) {
+                    assert(h.done());
+                    h.destroy();
+                }
+            }
+            assert(counter == (per_thread + live - 1) / live * live * steps);
+        });
+    }
+    for (auto& t : threads) t.join();
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / (per_thread * n_threads);
+}
+
+void CoroutineFrameBenchmark() {
+    std::cout << "\n--------------------------------------------------" << std::endl;
+    std::cout << " Coroutine frames: create + 3 suspends + destroy (ns/coroutine)" << std::endl;
+    std::cout << "--------------------------------------------------" << std::endl;
+
+    const size_t total = 4000000;
+    for (int n : {1, 4}) {
+        double base = CoroutineWorkload<DefaultFrameAllocator>(n, total / n);
+        double kz = CoroutineWorkload<KzAlloc::KzPromiseAllocator>(n, total / n);
+        printf("   %d thread(s): operator new %6.1f ns  KzPromiseAllocator %6.1f ns\n", n, base, kz);
+    }
+}
+
+// 256KB ~ 2MB 的缓冲区反复申请释放：扩展规格下由 ThreadCache 服务，否则每次都进 PageHeap 分片锁
+void ExtendedClassesBenchmark() {
+    std::cout << "\n--------------------------------------------------" << std::endl;
+#ifdef KZALLOC_EXTENDED_CLASSES
+    std::cout << " Buffer churn 384KB~1.5MB, 4 threads (extended classes ON)" << std::endl;
+#else
+    std::cout << " Buffer churn 384KB~1.5MB, 4 threads (extended classes OFF)" << std::endl;
+#endif
+    std::cout << "--------------------------------------------------" << std::endl;
+
+    const size_t sizes[] = {384 * 1024, 640 * 1024, 1536 * 1024};
+    const size_t ops = 100000;
+    const int n_threads = 4;
+
+    for (size_t sz : sizes) {
+        ReleaseStats before = PageHeap::GetInstance()->GetReleaseStats();
+        auto start = std::chrono::high_resolution_clock::now();
+
+        std::vector<std::thread> threads;
+        for (int t = 0; t < n_threads; ++t) {
+            threads.emplace_back([sz, ops]() {
+                void* ptrs[2];
+                for (size_t i = 0; i < ops; i += 2) {
+                    for (auto& p : ptrs) {
+                        p = KzAlloc::malloc(sz);
+                        *(volatile char*)p = 1;
+                    }
+                    for (auto p : ptrs) KzAlloc::free(p, sz);
+                }
+            });
+        }
+        for (auto& t : threads) t.join();
+
+        auto end = std::chrono::high_resolution_clock::now();
+        ReleaseStats after = PageHeap::GetInstance()->GetReleaseStats();
+        printf("   %5zuKB  %7.1f ns/op  lock_contended=%zu  path=%s\n", sz / 1024,
+               std::chrono::duration<double, std::nano>(end - start).count() / (ops * n_threads),
+               after.lockContended - before.lockContended, sz <= MAX_BYTES ? "thread cache" : "page heap");
+    }
+}
+
+#ifndef _WIN32
+// 堆布局导出：峰值后留下稀疏的存活对象，导出后校验每个页都恰好属于一个 Span
+void HeapDumpReport() {
+    std::cout << "\n--------------------------------------------------" << std::endl;
+    std::cout << " Heap dump (JSON lines)" << std::endl;
+    std::cout << "--------------------------------------------------" << std::endl;
+
+    std::vector<void*> keep;
+    std::vector<void*> drop;
+    for (int i = 0; i < 20000; ++i) {
+        void* p = KzAlloc::malloc(i % 2 ? 48 : 1000);
+        (i % 16 == 0 ? keep : drop).push_back(p);
+    }
+    keep.push_back(KzAlloc::malloc(1024 * 1024));
+    for (void* p : drop) KzAlloc::free(p);
+
+    const char* path = "/tmp/kzalloc_heap_dump.jsonl";
+    int fd = open(path, O_CREAT | O_TRUNC | O_WRONLY, 0644);
+    if (fd < 0) return;
+    bool ok = KzAlloc::DumpHeap(fd);
+    close(fd);
+    assert(ok);
+    (void)ok;
+
+    // 校验：Span 按页号升序且互不重叠，footer 的计数与行数一致
+    FILE* f = fopen(path, "r");
+    char line[1024];
+    size_t spans = 0, footerSpans = 0, inUse = 0, freeSpans = 0;
+    unsigned long long lastEnd = 0;
+    while (f && fgets(line, sizeof(line), f)) {
+        unsigned long long page = 0;
+        size_t pages = 0;
+        if (sscanf(line, "{\"type\":\"span\",\"page\":%llu,\"pages\":%zu", &page, &pages) == 2) {
+            assert(page >= lastEnd);
+            lastEnd = page + pages;
+            ++spans;
+            if (strstr(line, "\"in_use\"")) ++inUse; else ++freeSpans;
+        } else {
+            sscanf(line, "{\"type\":\"footer\",\"spans\":%zu", &footerSpans);
+        }
+    }
+    (void)lastEnd;
+    if (f) fclose(f);
+    assert(spans == footerSpans && spans > 0);
+    printf("   %zu spans (%zu in use, %zu free) written to %s\n", spans, inUse, freeSpans, path);
+    printf("   analyse with: kzalloc_heap_analyze %s\n", path);
+
+    for (void* p : keep) KzAlloc::free(p);
+}
+#else
+void HeapDumpReport() {}
+#endif
+
+#ifndef _WIN32
+// 按需统计报告：信号、控制文件、memfd 三种路径各触发一次
+void StatsReporterReport() {
+    std::cout << "\n--------------------------------------------------" << std::endl;
+    std::cout << " On-demand stats report (signal / control file / memfd)" << std::endl;
+    std::cout << "--------------------------------------------------" << std::endl;
+
+    StatsReporter* reporter = StatsReporter::GetInstance();
+    auto waitReports = [&](size_t n) {
+        for (int i = 0; i < 200 && reporter->ReportCount() < n; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        return reporter->ReportCount() >= n;
+    };
+    auto countLines = [](int fd) {
+        char buf[4096];
+        size_t lines = 0;
+        ssize_t n;
+        lseek(fd, 0, SEEK_SET);
+        while ((n = read(fd, buf, sizeof(buf))) > 0) {
+            for (ssize_t i = 0; i < n; ++i) lines += buf[i] == '\n';
+        }
+        return lines;
+    };
+
+    // 让报告里有点内容：另一个线程持有一些小对象
+    std::vector<void*> blocks;
+    for (int i = 0; i < 1000; ++i) blocks.push_back(KzAlloc::malloc(64 + (i % 8) * 64));
+
+    const char* path = "/tmp/kzalloc_stats.txt";
+    const char* control = "/tmp/kzalloc_stats.ctl";
+    StatsReporterOptions opts;
+    opts.outputPath = path;
+    opts.signalNumber = SIGUSR2;
+    opts.controlPath = control;
+    opts.pollIntervalMs = 20;
+    bool started = reporter->Start(opts);
+    assert(started);
+    (void)started;
+
+    size_t base = reporter->ReportCount();
+    raise(SIGUSR2);
+    bool bySignal = waitReports(base + 1);
+
+    int ctl = open(control, O_CREAT | O_WRONLY, 0644);
+    if (ctl >= 0) close(ctl);
+    bool byControl = waitReports(base + 2);
+    reporter->Stop();
+
+    int fd = open(path, O_RDONLY);
+    size_t fileLines = fd >= 0 ? countLines(fd) : 0;
+    if (fd >= 0) close(fd);
+    printf("   signal: %s  control file: %s  report lines: %zu (%s)\n",
+           bySignal ? "ok" : "FAILED", byControl ? "ok" : "FAILED", fileLines, path);
+    assert(bySignal && byControl && fileLines > 0);
+
+    // memfd：报告留在匿名内存文件里
+    StatsReporterOptions memOpts;
+    memOpts.outputPath = "memfd";
+    if (reporter->Start(memOpts)) {
+        base = reporter->ReportCount();
+        reporter->RequestReport();
+        bool ok = waitReports(base + 1);
+        reporter->Stop();
+        size_t memLines = countLines(reporter->MemFd());
+        printf("   memfd:  %s  report lines: %zu (/proc/%d/fd/%d)\n", ok ? "ok" : "FAILED", memLines,
+               (int)getpid(), reporter->MemFd());
+        assert(ok && memLines > 0);
+    }
+
+    for (void* p : blocks) KzAlloc::free(p);
+    unlink(path);
+}
+#else
+void StatsReporterReport() {}
+#endif
+
+#ifndef _WIN32
+// 用伪造的 PSI 文件驱动 PressureMonitor：停顿上升 -> 进入压力并清扫，停顿消失 -> 解除
+void PressureMonitorReport() {
+    std::cout << "\n--------------------------------------------------" << std::endl;
+    std::cout << " PSI-driven pressure monitor (fake PSI file)" << std::endl;
+    std::cout << "--------------------------------------------------" << std::endl;
+
+    static const char* path = "/tmp/kzalloc_fake_psi";
+    auto writePsi = [](uint64_t total) {
+        FILE* f = fopen(path, "w");
+        if (!f) return;
+        fprintf(f, "some avg10=0.00 avg60=0.00 avg300=0.00 total=%llu\n"
+                   "full avg10=0.00 avg60=0.00 avg300=0.00 total=0\n", (unsigned long long)total);
+        fclose(f);
+    };
+
+    // 先造出一批空闲驻留页
+    std::vector<void*> blocks;
+    for (int i = 0; i < 256; ++i) blocks.push_back(KzAlloc::malloc(64 * 1024));
+    for (void* p : blocks) KzAlloc::free(p);
+    PageHeap* ph = PageHeap::GetInstance();
+    size_t freeBefore = ph->GetReleaseStats().freePages;
+
+    uint64_t total = 0;
+    writePsi(total);
+    PressureMonitorOptions opts;
+    opts.path = path;
+    opts.intervalMs = 50;
+    PressureMonitor* pm = PressureMonitor::GetInstance();
+
+    // 工作线程：先在本地缓存里囤一批对象，之后只走快速路径 (64B 申请/释放，不触发慢速路径)
+    // 冲刷请求必须在这种线程上也能生效
+    std::atomic<int> workerPhase{0}; // 0 准备中 / 1 只走快速路径 / 2 请停下
+    size_t cachedBefore = 0, cachedAfter = 0, flushesBefore = 0, flushesAfter = 0;
+    std::thread worker([&] {
+        ThreadCache* tc = tls_manager.Get();
+        std::vector<void*> objs(400);
+        for (int round = 0; round < 16; ++round) {
+            for (auto& p : objs) p = KzAlloc::malloc(4096);
+            for (void* p : objs) KzAlloc::free(p);
+        }
+        void* warm = KzAlloc::malloc(64);
+        KzAlloc::free(warm);
+        cachedBefore = tc->CachedBytes();
+        flushesBefore = tc->Stats().flushes;
+        workerPhase.store(1, std::memory_order_release);
+        while (workerPhase.load(std::memory_order_acquire) == 1) {
+            void* p = KzAlloc::malloc(64);
+            KzAlloc::free(p);
+        }
+        cachedAfter = tc->CachedBytes();
+        flushesAfter = tc->Stats().flushes;
+    });
+    while (workerPhase.load(std::memory_order_acquire) == 0) std::this_thread::yield();
+
+    if (!pm->Start(opts)) {
+        puts("   monitor failed to start");
+        workerPhase.store(2, std::memory_order_release);
+        worker.join();
+        return;
+    }
+
+    // 每 10ms 累积 5ms 停顿 (50%)
+    for (int i = 0; i < 30; ++i) {
+        total += 5000;
+        writePsi(total);
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    PressureStats during = pm->GetStats();
+    size_t freeDuring = ph->GetReleaseStats().freePages;
+
+    // 停顿不再增长，等待解除
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    PressureStats after = pm->GetStats();
+    pm->Stop();
+    unlink(path);
+    workerPhase.store(2, std::memory_order_release);
+    worker.join();
+
+    printf("   under pressure: %s -> %s  (stall %.1f%% -> %.1f%%)\n",
+           during.underPressure ? "yes" : "no", after.underPressure ? "yes" : "no",
+           during.lastStallPercent, after.lastStallPercent);
+    printf("   events=%zu purges=%zu samples=%zu  free resident pages %zu -> %zu\n",
+           after.pressureEvents, after.purges, after.samples, freeBefore, freeDuring);
+    printf("   fast-path worker: cached %zu KB -> %zu KB, flushes %zu -> %zu\n",
+           cachedBefore / 1024, cachedAfter / 1024, flushesBefore, flushesAfter);
+    assert(during.underPressure && during.purges > 0);
+    assert(!after.underPressure);
+    assert(flushesAfter > flushesBefore);
+    assert(cachedAfter < cachedBefore);
+}
+#else
+void PressureMonitorReport() {}
+#endif
+
+#ifndef _WIN32
+// cgroup v2 内存限制探测：用伪造的 cgroup2 挂载点验证解析，再打印本进程实际采用的预算
+void CgroupLimitReport() {
+    std::cout << "\n--------------------------------------------------" << std::endl;
+    std::cout << " cgroup v2 memory limit detection" << std::endl;
+    std::cout << "--------------------------------------------------" << std::endl;
+
+    // 伪造的挂载点上只放根目录的文件；本进程不在 v2 层级中时探测结果为 0
+    const char* root = "/tmp/kzalloc_fake_cgroup";
+    mkdir(root, 0755);
+    auto writeFile = [&](const char* name, const char* content) {
+        char path[256];
+        snprintf(path, sizeof(path), "%s/%s", root, name);
+        FILE* f = fopen(path, "w");
+        if (!f) return;
+        fputs(content, f);
+        fclose(f);
+    };
+
+    FILE* self = fopen("/proc/self/cgroup", "r");
+    char line[512] = {0};
+    bool v2Root = false;
+    while (self && fgets(line, sizeof(line), self)) {
+        if (strcmp(line, "0::/\n") == 0) v2Root = true;
+    }
+    if (self) fclose(self);
+
+    writeFile("memory.max", "2147483648\n");
+    writeFile("memory.high", "max\n");
+    size_t maxOnly = GetCgroupMemoryLimit(root);
+    writeFile("memory.high", "1610612736\n");
+    size_t withHigh = GetCgroupMemoryLimit(root);
+    for (const char* name : {"memory.max", "memory.high"}) {
+        char path[256];
+        snprintf(path, sizeof(path), "%s/%s", root, name);
+        unlink(path);
+    }
+    rmdir(root);
+
+    printf("   fake root: max only=%zu MB, max+high=%zu MB%s\n", maxOnly >> 20, withHigh >> 20,
+           v2Root ? "" : " (process is not at a v2 root, expected 0)");
+    if (v2Root) {
+        assert(maxOnly == 2048ULL << 20);
+        assert(withHigh == 1536ULL << 20);
+    }
+
+    printf("   physical=%zu MB  effective=%zu MB  thread cache budget=%zu KB\n",
+           GetSystemPhysicalMemory() >> 20, GetEffectiveMemoryLimit() >> 20, ThreadCacheBudget() >> 10);
+}
+#else
+void CgroupLimitReport() {}
+#endif
+
+// ============================================================================
+// 第五部分：冷启动开销 (首次分配延迟 & 空闲 RSS)
+// ============================================================================
+#ifndef _WIN32
+// 读取当前进程常驻内存 (字节)
+static size_t ReadRSSBytes() {
+    FILE* f = fopen("/proc/self/statm", "r");
+    if (!f) return 0;
+    long pages = 0, resident = 0;
+    if (fscanf(f, "%ld %ld", &pages, &resident) != 2) resident = 0;
+    fclose(f);
+    return static_cast<size_t>(resident) * sysconf(_SC_PAGE_SIZE);
+}
+
+// 在 fork 出来的子进程中测量，保证分配器处于完全未初始化的状态
+// 必须在 main 中第一个运行 (任何 KzAlloc 调用之前)
+void ColdStartBenchmark() {
+    std::cout << "=> Running Cold Start Benchmark (first malloc latency & idle RSS)..." << std::endl;
+
+    struct Result {
+        long long firstSmallNs;
+        long long firstLargeNs;
+        long long secondSmallNs;
+        size_t rssBefore;
+        size_t rssAfter;
+    };
+
+    int fds[2];
+    if (pipe(fds) != 0) return;
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        Result r{};
+        r.rssBefore = ReadRSSBytes();
+
+        auto t0 = std::chrono::steady_clock::now();
+        void* small = KzAlloc::malloc(16);
+        auto t1 = std::chrono::steady_clock::now();
+        void* large = KzAlloc::malloc(512 * 1024);
+        auto t2 = std::chrono::steady_clock::now();
+        void* small2 = KzAlloc::malloc(16);
+        auto t3 = std::chrono::steady_clock::now();
+
+        r.rssAfter = ReadRSSBytes();
+        r.firstSmallNs = std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+        r.firstLargeNs = std::chrono::duration_cast<std::chrono::nanoseconds>(t2 - t1).count();
+        r.secondSmallNs = std::chrono::duration_cast<std::chrono::nanoseconds>(t3 - t2).count();
+
+        KzAlloc::free(small2);
+        KzAlloc::free(large);
+        KzAlloc::free(small);
+
+        ssize_t n = write(fds[1], &r, sizeof(r));
+        (void)n;
+        close(fds[1]);
+        _exit(0);
+    }
+
+    close(fds[1]);
+    Result r{};
+    ssize_t n = read(fds[0], &r, sizeof(r));
+    close(fds[0]);
+    waitpid(pid, nullptr, 0);
+    if (n != sizeof(r)) {
+        std::cout << "   Skipped (child failed)." << std::endl;
+        return;
+    }
+
+    std::cout << "   First malloc(16):      " << r.firstSmallNs / 1000.0 << " us" << std::endl;
+    std::cout << "   First malloc(512KB):   " << r.firstLargeNs / 1000.0 << " us" << std::endl;
+    std::cout << "   Second malloc(16):     " << r.secondSmallNs / 1000.0 << " us" << std::endl;
+    std::cout << "   RSS growth after init: " << (r.rssAfter - r.rssBefore) / 1024 << " KB" << std::endl;
+}
+#else
+void ColdStartBenchmark() {}
+#endif
+
+// ============================================================================
+// 生命周期分离：大批短命对象中夹杂少量长期存活的同规格对象
+// 对比不加提示与 malloc_hint(KZ_LONG_LIVED)，churn 结束后仍被占用的页数与 RSS
+// ============================================================================
+#ifndef _WIN32
+void LifetimeSegregationReport() {
+    std::cout << "\n--------------------------------------------------" << std::endl;
+    std::cout << " Lifetime segregation: 1 of 64 objects is long-lived" << std::endl;
+    std::cout << "--------------------------------------------------" << std::endl;
+
+    const size_t sz = 64;
+    const size_t rounds = 8;
+    const size_t batch = 64 * 1024;
+    const size_t keepEvery = 64;
+    PageHeap* ph = PageHeap::GetInstance();
+    CentralCache* cc = CentralCache::GetInstance();
+    auto settle = [&]() {
+        tls_manager.Get()->ReleaseAll();
+        cc->ReleaseEmptySpans(true);
+        ph->ReleaseFreeMemory();
+    };
+
+    for (int hinted = 0; hinted < 2; ++hinted) {
+        std::vector<void*> keep;
+        size_t usedBefore = 0, usedAfter = 0, rssBefore = 0, rssAfter = 0, longSpans = 0;
+        std::thread([&]() {
+            settle();
+            usedBefore = ph->GetReleaseStats().usedPages;
+            rssBefore = ReadRSSBytes();
+
+            // 每轮申请一大批，其中每 64 个留下一个，其余全部释放
+            std::vector<void*> temp;
+            temp.reserve(batch);
+            for (size_t r = 0; r < rounds; ++r) {
+                for (size_t i = 0; i < batch; ++i) {
+                    if (i % keepEvery == 0) {
+                        keep.push_back(hinted ? KzAlloc::malloc_hint(sz, KZ_LONG_LIVED) : KzAlloc::malloc(sz));
+                    } else {
+                        temp.push_back(KzAlloc::malloc(sz));
+                    }
+                }
+                for (void* p : temp) KzAlloc::free(p, sz);
+                temp.clear();
+            }
+
+            settle();
+            usedAfter = ph->GetReleaseStats().usedPages;
+            rssAfter = ReadRSSBytes();
+            longSpans = cc->GetClassStats(SizeUtils::Index(sz), true).spans;
+        }).join();
+
+        printf("   %-9s live=%5zu KB  pinned=%6zu KB  rss delta=%+6lld KB  long-lived spans=%zu\n",
+               hinted ? "hinted" : "no hint", keep.size() * sz / 1024,
+               (usedAfter - usedBefore) * PAGE_SIZE / 1024,
+               ((long long)rssAfter - (long long)rssBefore) / 1024, longSpans);
+
+        // free(ptr) 按 Span 把长寿命对象送回它的池
+        for (void* p : keep) KzAlloc::free(p);
+        settle();
+    }
+    assert(cc->GetClassStats(SizeUtils::Index(sz), true).inUseObjs == 0);
+}
+#else
+void LifetimeSegregationReport() {}
+#endif
+
 int main() {
+    // 冷启动测量必须在任何分配之前进行
+    ColdStartBenchmark();
+
     SizeUtils::Init();
     std::cout << "========================================" << std::endl;
     std::cout << "      KzMemoryPool Full Test Suite      " << std::endl;
@@ -451,6 +1977,8 @@ int main() {
     // 1. 基础正确性测试
     TestAlignment();
     TestLargeAlloc();
+    TestAlignedAlloc();
+    TestBasicAllocator();
 
     // 2. STL 适配测试
     TestSTLAdapter();
@@ -459,7 +1987,31 @@ int main() {
     TestCrossThreadFree();
     TestMultiThreadContention();
 
-    // 4. 性能对比测试
+    // 4. 分配器内部行为
+    SizeClassWasteReport();
+    AdaptiveThreadCacheBenchmark();
+    SpanChurnBenchmark();
+    FragmentationAfterPeakBenchmark();
+    CrossShardStealBenchmark();
+    LargeHandoffBenchmark();
+    SmallSpanChurnBenchmark();
+    ResidencyAccountingReport();
+    MadviseBatchReport();
+    PopulateWriteBenchmark();
+    PressureMonitorReport();
+    CgroupLimitReport();
+    StatsSnapshotBenchmark();
+    ThreadAccountingReport();
+    LifetimeSegregationReport();
+    FalseSharingBenchmark();
+    AlignedAllocBenchmark();
+    ExtendedClassesBenchmark();
+    BasicAllocatorPolicyMatrix();
+    CoroutineFrameBenchmark();
+    HeapDumpReport();
+    StatsReporterReport();
+
+    // 5. 性能对比测试
     std::cout << "\n========================================================" << std::endl;
     puts("固定内存申请测试：除512KB为两百万op,其他总数均为两千万op,工作集锁定为十万");
     std::cout << "========================================================" << std::endl;
@@ -0,0 +1,259 @@
+// heap_analyze.cpp
+// KzAlloc::DumpHeap 输出的离线分析工具
+// 用法: kzalloc_heap_analyze <dump.jsonl> [top_n]
+//
+// 回答 "为什么 RSS 是存活堆的好几倍"：
+// 1. 常驻内存拆分：存活对象 / 小对象 Span 内部碎片 / 空闲但驻留的页 (外部碎片)
+// 2. 每个 size class 的 Span 占用率直方图
+// 3. 最大的几段连续空闲区间 (相邻的空闲 Span 合并计算，不区分分片)
+//
+// 这是离线工具，运行在分配器之外，可以随意使用标准库
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct SpanRecord {
+    unsigned long long page = 0;
+    size_t pages = 0;
+    std::string state;
+    size_t shard = 0;
+    size_t objSize = 0;
+    long long sizeClass = -1;
+    size_t use = 0;
+    size_t objs = 0;
+    size_t released = 0;
+    bool longLived = false;
+};
+
+// 只解析 DumpHeap 自己写出的扁平 JSON，不是通用的 JSON 解析器
+bool FindField(const std::string& line, const char* key, std::string& value) {
+    std::string pattern = std::string("\"") + key + "\":";
+    size_t pos = line.find(pattern);
+    if (pos == std::string::npos) return false;
+    pos += pattern.size();
+    if (pos < line.size() && line[pos] == '"') {
+        size_t end = line.find('"', pos + 1);
+        if (end == std::string::npos) return false;
+        value = line.substr(pos + 1, end - pos - 1);
+    } else {
+        size_t end = line.find_first_of(",}", pos);
+        value = line.substr(pos, end == std::string::npos ? std::string::npos : end - pos);
+    }
+    return true;
+}
+
+unsigned long long NumberField(const std::string& line, const char* key) {
+    std::string value;
+    if (!FindField(line, key, value)) return 0;
+    return std::strtoull(value.c_str(), nullptr, 10);
+}
+
+long long SignedField(const std::string& line, const char* key) {
+    std::string value;
+    if (!FindField(line, key, value)) return 0;
+    return std::strtoll(value.c_str(), nullptr, 10);
+}
+
+std::string Human(double bytes) {
+    const char* units[] = {"B", "KB", "MB", "GB", "TB"};
+    int u = 0;
+    while (bytes >= 1024.0 && u < 4) {
+        bytes /= 1024.0;
+        ++u;
+    }
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%.1f %s", bytes, units[u]);
+    return buf;
+}
+
+struct ClassSummary {
+    size_t objSize = 0;
+    size_t spans = 0;
+    size_t pages = 0;
+    size_t use = 0;
+    size_t objs = 0;
+    size_t histogram[10] = {0}; // 占用率 [0,10%), [10%,20%) ... [90%,100%]
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::fprintf(stderr, "usage: %s <dump.jsonl> [top_n]\n", argv[0]);
+        return 2;
+    }
+    size_t topN = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 10;
+
+    std::ifstream in(argv[1]);
+    if (!in) {
+        std::fprintf(stderr, "cannot open %s\n", argv[1]);
+        return 1;
+    }
+
+    size_t pageShift = 13;
+    size_t maxBytes = 256 * 1024;
+    size_t expectedSpans = 0;
+    bool haveHeader = false;
+    bool haveFooter = false;
+    std::vector<SpanRecord> spans;
+
+    std::string line;
+    while (std::getline(in, line)) {
+        std::string type;
+        if (!FindField(line, "type", type)) continue;
+        if (type == "header") {
+            haveHeader = true;
+            pageShift = NumberField(line, "page_shift");
+            maxBytes = NumberField(line, "max_bytes");
+        } else if (type == "span") {
+            SpanRecord r;
+            r.page = NumberField(line, "page");
+            r.pages = NumberField(line, "pages");
+            FindField(line, "state", r.state);
+            r.shard = NumberField(line, "shard");
+            r.objSize = NumberField(line, "obj_size");
+            r.sizeClass = SignedField(line, "class");
+            r.use = NumberField(line, "use");
+            r.objs = NumberField(line, "objs");
+            r.released = NumberField(line, "released");
+            r.longLived = NumberField(line, "long_lived") != 0;
+            spans.push_back(r);
+        } else if (type == "footer") {
+            haveFooter = true;
+            expectedSpans = NumberField(line, "spans");
+        }
+    }
+
+    if (!haveHeader) {
+        std::fprintf(stderr, "not a KzAlloc heap dump (missing header)\n");
+        return 1;
+    }
+    if (!haveFooter || expectedSpans != spans.size()) {
+        std::fprintf(stderr, "warning: dump looks truncated (%zu spans, footer says %zu)\n",
+                     spans.size(), expectedSpans);
+    }
+
+    const double pageSize = static_cast<double>(1ULL << pageShift);
+
+    // ---------------------------------------------------------------
+    // 1. 常驻内存拆分
+    // ---------------------------------------------------------------
+    double liveSmall = 0, slackSmall = 0, tailSmall = 0, emptySpanBytes = 0;
+    double liveLarge = 0;
+    double longLivedSpanBytes = 0;
+    double hotFree = 0, coldFree = 0;
+    std::map<long long, ClassSummary> classes;
+
+    for (const SpanRecord& r : spans) {
+        double bytes = r.pages * pageSize;
+        if (r.state == "in_use") {
+            if (r.objSize > maxBytes || r.sizeClass < 0) {
+                liveLarge += bytes;
+                continue;
+            }
+            if (r.longLived) longLivedSpanBytes += bytes;
+            double live = static_cast<double>(r.use) * r.objSize;
+            double carved = static_cast<double>(r.objs) * r.objSize;
+            liveSmall += live;
+            tailSmall += bytes - carved;
+            if (r.use == 0) {
+                emptySpanBytes += carved;
+            } else {
+                slackSmall += carved - live;
+            }
+
+            ClassSummary& c = classes[r.sizeClass];
+            c.objSize = r.objSize;
+            c.spans++;
+            c.pages += r.pages;
+            c.use += r.use;
+            c.objs += r.objs;
+            size_t bucket = r.objs ? (r.use * 10) / r.objs : 0;
+            if (bucket > 9) bucket = 9;
+            c.histogram[bucket]++;
+        } else {
+            // 空闲 Span：released 页已归还 OS，其余仍驻留
+            hotFree += (r.pages - r.released) * pageSize;
+            coldFree += r.released * pageSize;
+        }
+    }
+
+    double live = liveSmall + liveLarge;
+    double resident = liveLarge + liveSmall + slackSmall + emptySpanBytes + tailSmall + hotFree;
+
+    std::printf("== Resident memory breakdown (%zu spans) ==\n", spans.size());
+    std::printf("  live objects (small)         %12s\n", Human(liveSmall).c_str());
+    std::printf("  live objects (large)         %12s\n", Human(liveLarge).c_str());
+    std::printf("  free slots in partial spans  %12s   (internal fragmentation)\n", Human(slackSmall).c_str());
+    std::printf("  empty spans held by central  %12s\n", Human(emptySpanBytes).c_str());
+    std::printf("  span tail waste              %12s\n", Human(tailSmall).c_str());
+    std::printf("  free resident pages          %12s   (external fragmentation / page cache)\n", Human(hotFree).c_str());
+    std::printf("  -----------------------------------------\n");
+    std::printf("  estimated resident           %12s   (%.2fx live)\n", Human(resident).c_str(),
+                live > 0 ? resident / live : 0.0);
+    std::printf("  released to OS (not resident)%12s\n", Human(coldFree).c_str());
+    std::printf("  long-lived pool spans        %12s   (included above)\n", Human(longLivedSpanBytes).c_str());
+    std::printf("  note: objects cached in thread caches count as live here\n");
+
+    // ---------------------------------------------------------------
+    // 2. 每个 size class 的占用率
+    // ---------------------------------------------------------------
+    std::printf("\n== Per-class occupancy (span count per 10%% bucket) ==\n");
+    std::printf("  %5s %8s %6s %8s %7s  %s\n", "class", "size", "spans", "pages", "occ%", "0%.......................100%");
+    for (const auto& kv : classes) {
+        const ClassSummary& c = kv.second;
+        double occ = c.objs ? 100.0 * c.use / c.objs : 0.0;
+        std::printf("  %5lld %8zu %6zu %8zu %6.1f%% ", kv.first, c.objSize, c.spans, c.pages, occ);
+        for (size_t b = 0; b < 10; ++b) std::printf(" %2zu", c.histogram[b]);
+        std::printf("\n");
+    }
+
+    // ---------------------------------------------------------------
+    // 3. 最大的连续空闲区间 (跨 Span、跨分片合并)
+    // ---------------------------------------------------------------
+    struct FreeRun {
+        unsigned long long page;
+        size_t pages;
+        size_t residentPages;
+    };
+    std::vector<FreeRun> runs;
+    std::vector<const SpanRecord*> freeSpans;
+    for (const SpanRecord& r : spans) {
+        if (r.state != "in_use") freeSpans.push_back(&r);
+    }
+    std::sort(freeSpans.begin(), freeSpans.end(),
+              [](const SpanRecord* a, const SpanRecord* b) { return a->page < b->page; });
+    for (const SpanRecord* r : freeSpans) {
+        if (!runs.empty() && runs.back().page + runs.back().pages == r->page) {
+            runs.back().pages += r->pages;
+            runs.back().residentPages += r->pages - r->released;
+        } else {
+            runs.push_back({r->page, r->pages, r->pages - r->released});
+        }
+    }
+    std::sort(runs.begin(), runs.end(), [](const FreeRun& a, const FreeRun& b) { return a.pages > b.pages; });
+
+    size_t freePages = 0;
+    for (const FreeRun& run : runs) freePages += run.pages;
+    std::printf("\n== Largest free runs (%zu runs, %s free in total) ==\n", runs.size(),
+                Human(freePages * pageSize).c_str());
+    for (size_t i = 0; i < runs.size() && i < topN; ++i) {
+        std::printf("  0x%012llx  %8zu pages  %10s  resident %zu pages\n",
+                    runs[i].page << pageShift, runs[i].pages, Human(runs[i].pages * pageSize).c_str(),
+                    runs[i].residentPages);
+    }
+    if (!runs.empty()) {
+        // 外部碎片率：1 - 最大空闲区间 / 全部空闲页
+        std::printf("  external fragmentation: %.1f%% (1 - largest run / total free)\n",
+                    100.0 * (1.0 - static_cast<double>(runs.front().pages) / freePages));
+    }
+    return 0;
+}